@@ -0,0 +1,339 @@
+"""Compare pugixml with lxml, ElementTree and xmltodict.
+
+Each workload runs in a fresh subprocess to record its peak RSS. Usage::
+
+    python -m benchmarks.compare --sizes 1M,100M --json results.json
+"""
+
+from __future__ import annotations
+
+import argparse
+import importlib.util
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+from collections.abc import Callable
+from pathlib import Path
+from typing import Any
+
+from .corpus import (
+    KINDS,
+    XPATH_QUERIES,
+    format_size,
+    generate_file,
+    parse_size,
+)
+
+LIBRARIES = ("pugixml", "lxml", "etree", "xmltodict")
+WORKLOADS = ("parse", "xpath", "iterate", "serialize")
+
+_ATOM = "{http://www.w3.org/2005/Atom}"
+
+
+def _peak_rss() -> int:
+    """Return the peak RSS of this process in bytes (Linux and macOS)."""
+    import resource  # noqa: PLC0415
+
+    # ru_maxrss is in KiB on Linux and in bytes on macOS.
+    peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    return peak * 1024 if sys.platform.startswith("linux") else peak
+
+
+# Workload factories: f(data, kind) -> (setup, run) where run(state) -> Any.
+Workload = tuple[Callable[[], Any], Callable[[Any], Any]]
+
+
+def _pugixml(workload: str, data: bytes, kind: str) -> Workload | None:
+    from pugixml import pugi  # noqa: PLC0415
+
+    def parse() -> pugi.XMLDocument:
+        doc = pugi.XMLDocument()
+        result = doc.load_buffer(data, len(data))
+        assert result, result.description()  # noqa: S101
+        return doc
+
+    def iterate(doc: pugi.XMLDocument) -> int:
+        count = 0
+        stack = [doc.document_element()]
+        while stack:
+            node = stack.pop()
+            node.name()
+            for attr in node.attributes():
+                attr.name()
+                attr.value()
+            count += 1
+            child = node.last_child()
+            while child:
+                if child.type() == pugi.NODE_ELEMENT:
+                    stack.append(child)
+                child = child.previous_sibling()
+        return count
+
+    def serialize(doc: pugi.XMLDocument) -> int:
+        writer = pugi.BytesWriter()
+        doc.save(writer, flags=pugi.FORMAT_RAW)
+        return len(writer)
+
+    query = XPATH_QUERIES[kind]
+    return {
+        "parse": (lambda: None, lambda _: parse()),
+        "xpath": (parse, lambda doc: len(doc.select_nodes(query))),
+        "iterate": (parse, iterate),
+        "serialize": (parse, serialize),
+    }[workload]
+
+
+def _lxml(workload: str, data: bytes, kind: str) -> Workload | None:
+    from lxml import etree  # noqa: PLC0415
+
+    def parse() -> Any:  # noqa: ANN401
+        return etree.fromstring(data)  # noqa: S320
+
+    def iterate(root: Any) -> int:  # noqa: ANN401
+        count = 0
+        for element in root.iter(etree.Element):
+            _ = element.tag
+            for _name, _value in element.items():
+                pass
+            count += 1
+        return count
+
+    query = XPATH_QUERIES[kind]
+    return {
+        "parse": (lambda: None, lambda _: parse()),
+        "xpath": (parse, lambda root: len(root.xpath(query))),
+        "iterate": (parse, iterate),
+        "serialize": (parse, lambda root: len(etree.tostring(root))),
+    }[workload]
+
+
+def _etree(workload: str, data: bytes, kind: str) -> Workload | None:
+    import xml.etree.ElementTree as ET  # noqa: N817, PLC0415
+
+    def parse() -> ET.Element:
+        return ET.fromstring(data)  # noqa: S314
+
+    def iterate(root: ET.Element) -> int:
+        count = 0
+        for element in root.iter():
+            _ = element.tag
+            for _name, _value in element.items():
+                pass
+            count += 1
+        return count
+
+    # ElementPath supports a subset of XPath, so the predicates on numbers
+    # are evaluated in Python.
+    def xpath(root: ET.Element) -> int:
+        if kind == "wide":
+            items = root.findall("item")
+            return sum(float(e.get("price", 0)) > 500 for e in items)
+        if kind == "deep":
+            return len(root.findall(".//leaf"))
+        if kind == "attributes":
+            return len(root.findall("record[@flag='true']"))
+        if kind == "catalog":
+            products = root.findall("product")
+            return sum(int(e.get("stock", 0)) > 50 for e in products)
+        if kind == "log":
+            return len(root.findall("entry[@level='ERROR']"))
+        prices = root.findall(f"{_ATOM}entry/{_ATOM}price")
+        return sum(float(e.get("amount", 0)) > 100 for e in prices)
+
+    return {
+        "parse": (lambda: None, lambda _: parse()),
+        "xpath": (parse, xpath),
+        "iterate": (parse, iterate),
+        "serialize": (parse, lambda root: len(ET.tostring(root))),
+    }[workload]
+
+
+def _xmltodict(
+    workload: str,
+    data: bytes,
+    kind: str,  # noqa: ARG001
+) -> Workload | None:
+    import xmltodict  # noqa: PLC0415
+
+    def parse() -> dict[str, Any]:
+        return xmltodict.parse(data)
+
+    def iterate(obj: Any) -> int:  # noqa: ANN401
+        count = 0
+        stack = [obj]
+        while stack:
+            value = stack.pop()
+            if isinstance(value, dict):
+                count += 1
+                stack.extend(value.values())
+            elif isinstance(value, list):
+                stack.extend(value)
+        return count
+
+    return {
+        "parse": (lambda: None, lambda _: parse()),
+        "xpath": None,
+        "iterate": (parse, iterate),
+        "serialize": (parse, lambda obj: len(xmltodict.unparse(obj))),
+    }[workload]
+
+
+_FACTORIES = {
+    "pugixml": _pugixml,
+    "lxml": _lxml,
+    "etree": _etree,
+    "xmltodict": _xmltodict,
+}
+
+_MODULES = {
+    "pugixml": "pugixml",
+    "lxml": "lxml",
+    "etree": "xml.etree.ElementTree",
+    "xmltodict": "xmltodict",
+}
+
+
+def run_worker(
+    library: str, workload: str, kind: str, path: Path, repeat: int
+) -> dict[str, Any] | None:
+    """Run the workload in this process and return the result."""
+    data = path.read_bytes()
+    factory = _FACTORIES[library](workload, data, kind)
+    if factory is None:
+        return None
+    setup, run = factory
+    state = setup()
+    baseline_rss = _peak_rss()
+    times = []
+    for _ in range(repeat):
+        start = time.perf_counter_ns()
+        result = run(state)
+        times.append(time.perf_counter_ns() - start)
+        del result
+    best = min(times) / 1e9
+    return {
+        "library": library,
+        "workload": workload,
+        "kind": kind,
+        "bytes": len(data),
+        "best_s": best,
+        "mean_s": sum(times) / len(times) / 1e9,
+        "ops": 1 / best if best > 0 else 0,
+        "mb_s": len(data) / best / 1e6 if best > 0 else 0,
+        "peak_rss": _peak_rss(),
+        "peak_rss_delta": max(0, _peak_rss() - baseline_rss),
+    }
+
+
+def _run_subprocess(
+    library: str,
+    workload: str,
+    kind: str,
+    path: Path,
+    repeat: int,
+    source_dir: Path | None,
+) -> dict[str, Any] | None:
+    root = Path(__file__).resolve().parent.parent
+    env = dict(os.environ)
+    if source_dir is not None:
+        # Import pugixml from the in-place build instead of the installed one.
+        env["PYTHONPATH"] = os.pathsep.join(
+            filter(None, [str(source_dir), env.get("PYTHONPATH")])
+        )
+    command = [
+        sys.executable,
+        "-m",
+        "benchmarks.compare",
+        "--worker",
+        library,
+        workload,
+        kind,
+        str(path),
+        str(repeat),
+    ]
+    output = subprocess.run(  # noqa: S603
+        command, check=True, capture_output=True, env=env, cwd=root
+    ).stdout
+    return json.loads(output)
+
+
+def _print_table(results: list[dict[str, Any]]) -> None:
+    header = (
+        f"{'corpus':<16} {'workload':<10} {'library':<10} "
+        f"{'best (ms)':>12} {'MB/s':>10} {'peak RSS (MB)':>14}"
+    )
+    print(header)  # noqa: T201
+    print("-" * len(header))  # noqa: T201
+    for r in results:
+        corpus = f"{r['kind']}-{format_size(r['size'])}"
+        print(  # noqa: T201
+            f"{corpus:<16} {r['workload']:<10} {r['library']:<10} "
+            f"{r['best_s'] * 1e3:>12.3f} {r['mb_s']:>10.1f} "
+            f"{r['peak_rss'] / 1e6:>14.1f}"
+        )
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--worker", nargs=5, help=argparse.SUPPRESS)
+    parser.add_argument("--kinds", default=",".join(KINDS))
+    parser.add_argument("--sizes", default="1M")
+    parser.add_argument("--libraries", default=",".join(LIBRARIES))
+    parser.add_argument("--workloads", default=",".join(WORKLOADS))
+    parser.add_argument("--repeat", type=int, default=5)
+    parser.add_argument(
+        "--corpus-dir",
+        type=Path,
+        default=Path(tempfile.gettempdir()) / "pugixml-corpus",
+    )
+    parser.add_argument("--json", type=Path, help="write the results to JSON")
+    parser.add_argument(
+        "--source-dir",
+        type=Path,
+        help="import pugixml from this directory instead of the installed one",
+    )
+    args = parser.parse_args()
+
+    if args.worker:
+        library, workload, kind, path, repeat = args.worker
+        result = run_worker(library, workload, kind, Path(path), int(repeat))
+        print(json.dumps(result))  # noqa: T201
+        return
+
+    libraries = []
+    for library in args.libraries.split(","):
+        if importlib.util.find_spec(_MODULES[library]) is None:
+            message = f"skipping {library}: not installed"
+            print(message, file=sys.stderr)  # noqa: T201
+            continue
+        libraries.append(library)
+
+    results = []
+    for size in map(parse_size, args.sizes.split(",")):
+        for kind in args.kinds.split(","):
+            path = args.corpus_dir / f"{kind}-{format_size(size)}.xml"
+            generate_file(kind, size, path)
+            for workload in args.workloads.split(","):
+                for library in libraries:
+                    result = _run_subprocess(
+                        library,
+                        workload,
+                        kind,
+                        path,
+                        args.repeat,
+                        args.source_dir,
+                    )
+                    if result is not None:
+                        result["size"] = size
+                        results.append(result)
+
+    _print_table(results)
+    if args.json:
+        args.json.write_text(json.dumps(results, indent=2))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,84 @@
+from __future__ import annotations
+
+import os
+from pathlib import Path
+
+import pytest
+
+from pugixml import pugi
+
+from .corpus import KINDS, format_size, generate_file, parse_size
+
+# Corpus sizes, e.g. PUGIXML_BENCH_SIZES=1K,1M,100M,1G
+SIZES = [
+    parse_size(size)
+    for size in os.environ.get("PUGIXML_BENCH_SIZES", "1K,1M").split(",")
+]
+
+
+class Corpus:
+    def __init__(self, kind: str, size: int, path: Path) -> None:
+        self.kind = kind
+        self.size = size
+        self.path = path
+        self._data: bytes | None = None
+
+    def __repr__(self) -> str:
+        return f"{self.kind}-{format_size(self.size)}"
+
+    @property
+    def data(self) -> bytes:
+        if self._data is None:
+            self._data = self.path.read_bytes()
+        return self._data
+
+    @property
+    def nbytes(self) -> int:
+        return self.path.stat().st_size
+
+    def load(self) -> pugi.XMLDocument:
+        doc = pugi.XMLDocument()
+        result = doc.load_buffer(self.data, len(self.data))
+        assert result, result.description()
+        return doc
+
+
+def _corpus_dir(config: pytest.Config) -> Path:
+    path = os.environ.get("PUGIXML_BENCH_CORPUS")
+    if path:
+        return Path(path)
+    return config.cache.mkdir("pugixml-corpus")
+
+
+@pytest.fixture(
+    scope="session",
+    params=[(kind, size) for size in SIZES for kind in KINDS],
+    ids=lambda param: f"{param[0]}-{format_size(param[1])}",
+)
+def corpus(request: pytest.FixtureRequest) -> Corpus:
+    kind, size = request.param
+    path = _corpus_dir(request.config) / f"{kind}-{format_size(size)}.xml"
+    return Corpus(kind, size, generate_file(kind, size, path))
+
+
+@pytest.fixture(scope="session")
+def document(corpus: Corpus) -> pugi.XMLDocument:
+    return corpus.load()
+
+
+@pytest.fixture
+def throughput(benchmark):  # noqa: ANN001, ANN201
+    """Return a function to record the throughput of the benchmark in MB/s.
+
+    The function must be called after the benchmark has run.
+    """
+
+    def report(nbytes: int) -> None:
+        benchmark.extra_info["bytes"] = nbytes
+        stats = benchmark.stats
+        if stats is not None and stats.stats.mean > 0:
+            benchmark.extra_info["MB/s"] = round(
+                nbytes / stats.stats.mean / 1e6, 2
+            )
+
+    return report
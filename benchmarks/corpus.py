@@ -0,0 +1,246 @@
+"""Generate reproducible XML corpora for the benchmarks.
+
+Usage::
+
+    python -m benchmarks.corpus --kind feed --size 100M -o feed.xml
+"""
+
+from __future__ import annotations
+
+import argparse
+import random
+import re
+from collections.abc import Callable, Iterator
+from pathlib import Path
+from typing import BinaryIO
+
+KINDS = ("wide", "deep", "attributes", "feed", "catalog", "log")
+
+# XPath expressions that select a large part of each corpus
+XPATH_QUERIES = {
+    "wide": "/items/item[@price > 500]",
+    "deep": "//leaf",
+    "attributes": "/records/record[@flag = 'true']/@a0",
+    "feed": "/*[local-name()='feed']/*[local-name()='entry']"
+    "/*[local-name()='price'][@amount > 100]",
+    "catalog": "/catalog/product[@stock > 50]/name",
+    "log": "/log/entry[@level = 'ERROR']",
+}
+
+# Names of the top-level records of each corpus, e.g. for load_file_parallel()
+RECORD_TAGS = {
+    "wide": "item",
+    "deep": "node",
+    "attributes": "record",
+    "feed": "entry",
+    "catalog": "product",
+    "log": "entry",
+}
+
+_UNITS = {"": 1, "K": 1024, "M": 1024**2, "G": 1024**3}
+
+_WORDS = (
+    "alpha bravo charlie delta echo foxtrot golf hotel india juliett kilo "
+    "lima mike november oscar papa quebec romeo sierra tango uniform victor "
+    "whiskey xray yankee zulu"
+).split()
+
+# CJK ideographs and katakana for the text-heavy non-ASCII corpus
+_CJK = "".join(chr(c) for c in range(0x4E00, 0x4E00 + 512)) + "".join(
+    chr(c) for c in range(0x30A1, 0x30F7)
+)
+
+
+def parse_size(value: str) -> int:
+    """Convert a size such as ``'1K'``, ``'10M'`` or ``'1G'`` to bytes."""
+    match = re.fullmatch(r"\s*(\d+)\s*([KMG]?)B?\s*", value.upper())
+    if match is None:
+        msg = f"invalid size: {value!r}"
+        raise ValueError(msg)
+    return int(match.group(1)) * _UNITS[match.group(2)]
+
+
+def format_size(size: int) -> str:
+    """Convert bytes to the size string, e.g. ``1048576`` -> ``'1M'``."""
+    for unit in ("G", "M", "K"):
+        if size >= _UNITS[unit] and size % _UNITS[unit] == 0:
+            return f"{size // _UNITS[unit]}{unit}"
+    return str(size)
+
+
+def _sentence(rng: random.Random, words: int) -> str:
+    return " ".join(rng.choice(_WORDS) for _ in range(words))
+
+
+def _wide(rng: random.Random) -> Iterator[str]:
+    yield "<items>\n"
+    n = 0
+    while True:
+        yield (
+            f'  <item id="{n}" price="{rng.uniform(0, 1000):.2f}">'
+            f"{_sentence(rng, 3)}</item>\n"
+        )
+        n += 1
+
+
+def _deep(rng: random.Random, depth: int = 256) -> Iterator[str]:
+    yield "<tree>\n"
+    n = 0
+    while True:
+        parts = []
+        for level in range(depth):
+            parts.append(f'<node level="{level}" id="{n}">')
+            n += 1
+        parts.extend(
+            (f"<leaf>{_sentence(rng, 2)}</leaf>", "</node>" * depth, "\n")
+        )
+        yield "".join(parts)
+
+
+def _attributes(rng: random.Random, count: int = 20) -> Iterator[str]:
+    yield "<records>\n"
+    n = 0
+    while True:
+        attrs = " ".join(
+            f'a{i}="{rng.randrange(1 << 31)}"' for i in range(count)
+        )
+        yield (
+            f'  <record id="{n}" flag="{rng.choice(("true", "false"))}" '
+            f'ratio="{rng.random():.6f}" {attrs}/>\n'
+        )
+        n += 1
+
+
+def _feed(rng: random.Random) -> Iterator[str]:
+    yield (
+        '<?xml version="1.0" encoding="utf-8"?>\n'
+        '<feed xmlns="http://www.w3.org/2005/Atom">\n'
+        "  <title>Benchmark feed</title>\n"
+        "  <updated>2024-01-01T00:00:00Z</updated>\n"
+    )
+    n = 0
+    while True:
+        author = rng.choice(_WORDS)
+        yield (
+            "  <entry>\n"
+            f"    <id>urn:uuid:{rng.getrandbits(128):032x}</id>\n"
+            f"    <title>{_sentence(rng, 5).title()}</title>\n"
+            f"    <updated>2024-{rng.randint(1, 12):02d}-"
+            f"{rng.randint(1, 28):02d}T{rng.randint(0, 23):02d}:00:00Z"
+            "</updated>\n"
+            f"    <author><name>{author}</name>"
+            f"<email>{author}@example.com</email></author>\n"
+            f'    <link rel="alternate" href="https://example.com/{n}"/>\n'
+            f'    <category term="{rng.choice(_WORDS)}"/>\n'
+            f'    <price currency="USD" amount="{rng.uniform(1, 500):.2f}"/>\n'
+            f"    <stock>{rng.randint(0, 10000)}</stock>\n"
+            f"    <available>{rng.choice(('true', 'false'))}</available>\n"
+            f'    <summary type="html">&lt;p&gt;{_sentence(rng, 12)} '
+            f"&amp;amp; more&lt;/p&gt;</summary>\n"
+            f"    <content><![CDATA[<p>{_sentence(rng, 40)}</p>]]></content>\n"
+            "  </entry>\n"
+        )
+        n += 1
+
+
+def _cjk_text(rng: random.Random, length: int) -> str:
+    return "".join(rng.choices(_CJK, k=length))
+
+
+def _catalog(rng: random.Random) -> Iterator[str]:
+    yield '<?xml version="1.0" encoding="utf-8"?>\n<catalog>\n'
+    n = 0
+    while True:
+        yield (
+            f'  <product id="{n}" stock="{rng.randint(0, 100)}">'
+            f"<name>{_cjk_text(rng, rng.randint(4, 12))}</name>"
+            f"<maker>{_cjk_text(rng, 6)}</maker>"
+            f"<description>{_cjk_text(rng, rng.randint(40, 120))}"
+            "</description></product>\n"
+        )
+        n += 1
+
+
+def _log(rng: random.Random) -> Iterator[str]:
+    yield "<log>\n"
+    n = 0
+    while True:
+        lines = "\n".join(
+            _sentence(rng, 12) for _ in range(rng.randint(64, 1024))
+        )
+        yield (
+            f'  <entry id="{n}" level="{rng.choice(("INFO", "ERROR"))}">'
+            f"{lines}</entry>\n"
+        )
+        n += 1
+
+
+_Generator = Callable[[random.Random], Iterator[str]]
+
+_GENERATORS: dict[str, tuple[_Generator, str]] = {
+    "wide": (_wide, "</items>\n"),
+    "deep": (_deep, "</tree>\n"),
+    "attributes": (_attributes, "</records>\n"),
+    "feed": (_feed, "</feed>\n"),
+    "catalog": (_catalog, "</catalog>\n"),
+    "log": (_log, "</log>\n"),
+}
+
+
+def generate(kind: str, size: int, stream: BinaryIO, seed: int = 0) -> int:
+    """Write the document of *kind* of about *size* bytes to *stream*.
+
+    The document is made of whole records (elements or subtrees), so the
+    size is rounded to the record boundary. The output is deterministic for
+    the same arguments.
+
+    Returns:
+        int: The number of bytes written.
+    """
+    if kind not in _GENERATORS:
+        msg = f"unknown corpus kind: {kind!r}"
+        raise ValueError(msg)
+    generator, footer = _GENERATORS[kind]
+    footer_size = len(footer)
+    written = 0
+    chunk: list[bytes] = []
+    chunk_size = 0
+    for part in generator(random.Random(seed)):
+        data = part.encode()
+        chunk.append(data)
+        chunk_size += len(data)
+        if written + chunk_size + footer_size >= size:
+            break
+        if chunk_size >= 1 << 20:
+            written += stream.write(b"".join(chunk))
+            chunk.clear()
+            chunk_size = 0
+    chunk.append(footer.encode())
+    written += stream.write(b"".join(chunk))
+    return written
+
+
+def generate_file(kind: str, size: int, path: Path, seed: int = 0) -> Path:
+    """Generate the corpus file if it does not exist, and return its path."""
+    if not path.exists():
+        path.parent.mkdir(parents=True, exist_ok=True)
+        tmp = path.with_suffix(".tmp")
+        with tmp.open("wb") as f:
+            generate(kind, size, f, seed)
+        tmp.replace(path)
+    return path
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--kind", choices=KINDS, default="feed")
+    parser.add_argument("--size", type=parse_size, default="1M")
+    parser.add_argument("--seed", type=int, default=0)
+    parser.add_argument("-o", "--output", type=Path, required=True)
+    args = parser.parse_args()
+    with args.output.open("wb") as f:
+        generate(args.kind, args.size, f, args.seed)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,152 @@
+"""Build and install pugixml with profile-guided optimization (PGO).
+
+The module is built with instrumentation, trained with the parse, XPath and
+serialize workloads over the generated corpora, then rebuilt with the
+recorded profiles. Usage::
+
+    python -m benchmarks.pgo build [--arch x86-64-v3] [--size 16M]
+    python -m benchmarks.pgo train [--size 16M]
+"""
+
+from __future__ import annotations
+
+import argparse
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+from .corpus import (
+    KINDS,
+    XPATH_QUERIES,
+    format_size,
+    generate_file,
+    parse_size,
+)
+
+_ROOT = Path(__file__).resolve().parent.parent
+
+
+def train(size: int, corpus_dir: Path, repeat: int) -> None:
+    """Run the training workload with the installed module."""
+    from pugixml import pugi  # noqa: PLC0415
+
+    for kind in KINDS:
+        path = generate_file(
+            kind, size, corpus_dir / f"{kind}-{format_size(size)}.xml"
+        )
+        data = path.read_bytes()
+        query = pugi.XPathQuery(XPATH_QUERIES[kind])
+        for _ in range(repeat):
+            doc = pugi.XMLDocument()
+            assert doc.load_buffer(data, len(data))
+            assert doc.load_file(path)
+            assert doc.load_string(data.decode())
+            assert len(query.evaluate_node_set(doc)) > 0
+            for node in doc.document_element().children():
+                node.name()
+                for attr in node.attributes():
+                    attr.value()
+            doc.save(pugi.BytesWriter())
+            doc.save(pugi.StringWriter(), flags=pugi.FORMAT_RAW)
+            copy = pugi.XMLDocument()
+            copy.reset(doc)
+
+
+def _install(
+    mode: str, build_dir: Path, profile_dir: Path, arch: str | None
+) -> None:
+    command = [
+        sys.executable,
+        "-m",
+        "pip",
+        "install",
+        "--force-reinstall",
+        "--no-deps",
+        str(_ROOT),
+        # The object files must have the same paths in both builds.
+        f"--config-settings=build-dir={build_dir}",
+        f"--config-settings=cmake.define.PUGIXML_PGO={mode}",
+        f"--config-settings=cmake.define.PUGIXML_PGO_DIR={profile_dir}",
+    ]
+    if arch:
+        command.append(f"--config-settings=cmake.define.PUGIXML_ARCH={arch}")
+    subprocess.run(command, check=True)  # noqa: S603
+
+
+def _merge_profiles(profile_dir: Path) -> None:
+    """Merge the raw profiles of clang into ``default.profdata``."""
+    raw_profiles = sorted(profile_dir.glob("*.profraw"))
+    if not raw_profiles:
+        return  # GCC reads the .gcda files directly
+    profdata = os.environ.get("LLVM_PROFDATA") or shutil.which("llvm-profdata")
+    if profdata is None and sys.platform == "darwin":
+        profdata = "xcrun llvm-profdata"
+    if profdata is None:
+        msg = "llvm-profdata is not found; set LLVM_PROFDATA"
+        raise RuntimeError(msg)
+    subprocess.run(  # noqa: S603
+        [
+            *profdata.split(),
+            "merge",
+            "-o",
+            str(profile_dir / "default.profdata"),
+            *map(str, raw_profiles),
+        ],
+        check=True,
+    )
+
+
+def build(args: argparse.Namespace) -> None:
+    build_dir = args.build_dir.resolve()
+    profile_dir = build_dir / "profiles"
+    shutil.rmtree(profile_dir, ignore_errors=True)
+    profile_dir.mkdir(parents=True)
+
+    _install("GENERATE", build_dir, profile_dir, args.arch)
+    subprocess.run(  # noqa: S603
+        [
+            sys.executable,
+            "-m",
+            "benchmarks.pgo",
+            "train",
+            "--size",
+            format_size(args.size),
+            "--repeat",
+            str(args.repeat),
+            "--corpus-dir",
+            str(args.corpus_dir),
+        ],
+        check=True,
+        cwd=_ROOT,
+    )
+    _merge_profiles(profile_dir)
+    _install("USE", build_dir, profile_dir, args.arch)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("command", choices=("build", "train"))
+    parser.add_argument("--size", type=parse_size, default="16M")
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument(
+        "--corpus-dir",
+        type=Path,
+        default=Path(tempfile.gettempdir()) / "pugixml-corpus",
+    )
+    parser.add_argument(
+        "--build-dir", type=Path, default=_ROOT / "build" / "pgo"
+    )
+    parser.add_argument("--arch", help="the target architecture (-march)")
+    args = parser.parse_args()
+
+    if args.command == "train":
+        train(args.size, args.corpus_dir, args.repeat)
+    else:
+        build(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,79 @@
+from __future__ import annotations
+
+from typing import TYPE_CHECKING
+
+import pytest
+
+from pugixml import pugi
+
+if TYPE_CHECKING:
+    from pytest_benchmark.fixture import BenchmarkFixture
+
+    from .conftest import Corpus
+
+# XPath expressions that select the numeric attributes of each corpus
+ATTRIBUTES = {
+    "wide": "/items/item/@price",
+    "deep": "//node/@id",
+    "attributes": "/records/record/@*",
+    "feed": "//*[local-name()='price']/@amount",
+}
+
+# XPath expressions that select the elements with the text of each corpus
+TEXTS = {
+    "wide": "/items/item",
+    "deep": "//leaf",
+    "attributes": "/records/record",
+    "feed": "//*[local-name()='stock']",
+}
+
+METHODS = [
+    "as_bool",
+    "as_double",
+    "as_float",
+    "as_int",
+    "as_llong",
+    "as_string",
+    "as_uint",
+    "as_ullong",
+]
+
+
+@pytest.mark.parametrize("method", METHODS)
+def test_attribute_as(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    document: pugi.XMLDocument,
+    method: str,
+) -> None:
+    attributes = [
+        node.attribute()
+        for node in document.select_nodes(ATTRIBUTES[corpus.kind])
+    ]
+    methods = [getattr(attr, method) for attr in attributes]
+
+    def convert() -> None:
+        for func in methods:
+            func()
+
+    benchmark(convert)
+    benchmark.extra_info["values"] = len(methods)
+
+
+@pytest.mark.parametrize("method", METHODS)
+def test_text_as(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    document: pugi.XMLDocument,
+    method: str,
+) -> None:
+    nodes = document.select_nodes(TEXTS[corpus.kind])
+    texts = [node.node().text() for node in nodes]
+    methods = [getattr(text, method) for text in texts]
+
+    def convert() -> None:
+        for func in methods:
+            func()
+
+    benchmark(convert)
+    benchmark.extra_info["values"] = len(methods)
@@ -0,0 +1,115 @@
+from __future__ import annotations
+
+from typing import TYPE_CHECKING
+
+from pugixml import pugi
+
+from .corpus import RECORD_TAGS
+
+if TYPE_CHECKING:
+    from collections.abc import Callable
+
+    from pytest_benchmark.fixture import BenchmarkFixture
+
+    from .conftest import Corpus
+
+
+def test_load_buffer(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    throughput: Callable[[int], None],
+) -> None:
+    data = corpus.data
+    doc = pugi.XMLDocument()
+    result = benchmark(doc.load_buffer, data, len(data))
+    assert result
+    throughput(len(data))
+
+
+def test_load_file(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    throughput: Callable[[int], None],
+) -> None:
+    doc = pugi.XMLDocument()
+    result = benchmark(doc.load_file, corpus.path)
+    assert result
+    throughput(corpus.nbytes)
+
+
+def test_load_file_fragments(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    throughput: Callable[[int], None],
+) -> None:
+    fragments = benchmark(
+        pugi.load_file_fragments, corpus.path, RECORD_TAGS[corpus.kind]
+    )
+    assert isinstance(fragments, list)
+    throughput(corpus.nbytes)
+
+
+def test_load_file_parallel(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    throughput: Callable[[int], None],
+) -> None:
+    doc = pugi.XMLDocument()
+    result = benchmark(
+        doc.load_file_parallel, corpus.path, RECORD_TAGS[corpus.kind]
+    )
+    assert result
+    throughput(corpus.nbytes)
+
+
+def test_load_string(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    throughput: Callable[[int], None],
+) -> None:
+    contents = corpus.data.decode()
+    doc = pugi.XMLDocument()
+    result = benchmark(doc.load_string, contents)
+    assert result
+    throughput(corpus.nbytes)
+
+
+def test_load_string_minimal(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    throughput: Callable[[int], None],
+) -> None:
+    contents = corpus.data.decode()
+    doc = pugi.XMLDocument()
+    result = benchmark(doc.load_string, contents, pugi.PARSE_MINIMAL)
+    assert result
+    throughput(corpus.nbytes)
+
+
+def test_load_buffer_fast_scan(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    throughput: Callable[[int], None],
+) -> None:
+    data = corpus.data
+    doc = pugi.XMLDocument()
+    result = benchmark(
+        doc.load_buffer,
+        data,
+        len(data),
+        pugi.PARSE_MINIMAL | pugi.PARSE_FAST_SCAN,
+    )
+    assert result
+    throughput(len(data))
+
+
+def test_load_buffer_minimal(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    throughput: Callable[[int], None],
+) -> None:
+    data = corpus.data
+    doc = pugi.XMLDocument()
+    result = benchmark(doc.load_buffer, data, len(data), pugi.PARSE_MINIMAL)
+    assert result
+    throughput(len(data))
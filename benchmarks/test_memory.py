@@ -0,0 +1,61 @@
+from __future__ import annotations
+
+from typing import TYPE_CHECKING
+
+from pugixml import pugi
+
+if TYPE_CHECKING:
+    from collections.abc import Callable
+
+    from pytest_benchmark.fixture import BenchmarkFixture
+
+    from .conftest import Corpus
+
+
+def _report_memory(benchmark: BenchmarkFixture, corpus: Corpus) -> None:
+    # The pages are known only if they are allocated while tracking, which
+    # is kept out of the measured runs.
+    pugi.memory.set_block_tracking(True)
+    try:
+        usage = corpus.load().memory_usage()
+    finally:
+        pugi.memory.set_block_tracking(False)
+    count = usage["nodes"] + usage["attributes"]
+    benchmark.extra_info["compact"] = pugi.BUILD_OPTIONS["PUGIXML_COMPACT"]
+    benchmark.extra_info["page_bytes"] = usage["page_bytes"]
+    benchmark.extra_info["struct_bytes"] = usage["struct_bytes"]
+    if count > 0:
+        benchmark.extra_info["bytes_per_object"] = round(
+            usage["page_bytes"] / count, 2
+        )
+
+
+def test_memory_load(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    throughput: Callable[[int], None],
+) -> None:
+    data = corpus.data
+    doc = pugi.XMLDocument()
+    result = benchmark(doc.load_buffer, data, len(data))
+    assert result
+    throughput(len(data))
+    _report_memory(benchmark, corpus)
+
+
+def test_memory_traverse(
+    benchmark: BenchmarkFixture,
+    corpus: Corpus,
+    throughput: Callable[[int], None],
+) -> None:
+    doc = corpus.load()
+
+    def run() -> int:
+        count = 0
+        for node in doc.select_nodes("//node()"):
+            count += len(node.node().attributes())
+        return count
+
+    benchmark(run)
+    throughput(corpus.nbytes)
+    _report_memory(benchmark, corpus)
@@ -0,0 +1,139 @@
+from __future__ import annotations
+
+import contextlib
+from contextlib import closing
+from typing import TYPE_CHECKING
+
+import pytest
+
+from pugixml import pugi
+
+if TYPE_CHECKING:
+    from collections.abc import Callable
+    from pathlib import Path
+
+    from pytest_benchmark.fixture import BenchmarkFixture
+
+
+class _NullWriter(pugi.XMLWriter):
+    def write(self, data: bytes, size: int) -> None:
+        pass
+
+
+class _NullStream:
+    def write(self, data: str) -> int:
+        return len(data)
+
+    def flush(self) -> None:
+        pass
+
+
+def _size(document: pugi.XMLDocument, flags: int) -> int:
+    writer = pugi.BytesWriter()
+    document.save(writer, flags=flags)
+    return len(writer)
+
+
+@pytest.fixture(
+    params=[pugi.FORMAT_DEFAULT, pugi.FORMAT_RAW], ids=["indent", "raw"]
+)
+def flags(request: pytest.FixtureRequest) -> int:
+    return request.param
+
+
+@pytest.mark.parametrize(
+    "writer_type",
+    [pugi.BytesWriter, pugi.StringWriter, _NullWriter],
+    ids=["bytes", "string", "python"],
+)
+def test_print(
+    benchmark: BenchmarkFixture,
+    document: pugi.XMLDocument,
+    throughput: Callable[[int], None],
+    writer_type: type[pugi.XMLWriter],
+    flags: int,
+) -> None:
+    def save() -> None:
+        document.print(writer_type(), flags=flags)
+
+    benchmark(save)
+    throughput(_size(document, flags))
+
+
+@pytest.mark.parametrize(
+    "writer_type",
+    [pugi.BytesWriter, _NullWriter],
+    ids=["bytes", "python"],
+)
+def test_print_parallel(
+    benchmark: BenchmarkFixture,
+    document: pugi.XMLDocument,
+    throughput: Callable[[int], None],
+    writer_type: type[pugi.XMLWriter],
+    flags: int,
+) -> None:
+    def save() -> None:
+        document.print_parallel(writer_type(), flags=flags)
+
+    benchmark(save)
+    throughput(_size(document, flags))
+
+
+def test_print_writer(
+    benchmark: BenchmarkFixture,
+    document: pugi.XMLDocument,
+    throughput: Callable[[int], None],
+    flags: int,
+) -> None:
+    def save() -> None:
+        with contextlib.redirect_stdout(_NullStream()):
+            document.print(pugi.PrintWriter(), flags=flags)
+
+    benchmark(save)
+    throughput(_size(document, flags))
+
+
+def test_save_file(
+    benchmark: BenchmarkFixture,
+    document: pugi.XMLDocument,
+    throughput: Callable[[int], None],
+    tmp_path: Path,
+    flags: int,
+) -> None:
+    path = tmp_path / "output.xml"
+    assert benchmark(document.save_file, path, flags=flags)
+    throughput(_size(document, flags))
+
+
+def test_save_file_parallel(
+    benchmark: BenchmarkFixture,
+    document: pugi.XMLDocument,
+    throughput: Callable[[int], None],
+    tmp_path: Path,
+    flags: int,
+) -> None:
+    path = tmp_path / "output.xml"
+
+    def save() -> None:
+        with closing(pugi.FileWriter(path)) as writer:
+            document.print_parallel(writer, flags=flags)
+
+    benchmark(save)
+    throughput(_size(document, flags))
+
+
+def test_save_file_writer(
+    benchmark: BenchmarkFixture,
+    document: pugi.XMLDocument,
+    throughput: Callable[[int], None],
+    tmp_path: Path,
+    flags: int,
+) -> None:
+    path = tmp_path / "output.xml"
+
+    def save() -> None:
+        with closing(pugi.FileWriter(path)) as writer:
+            document.save(writer, flags=flags)
+
+    benchmark(save)
+    throughput(_size(document, flags))
@@ -0,0 +1,112 @@
+from __future__ import annotations
+
+from typing import TYPE_CHECKING
+
+from pugixml import pugi
+
+if TYPE_CHECKING:
+    from pytest_benchmark.fixture import BenchmarkFixture
+
+
+class _CountingWalker(pugi.XMLTreeWalker):
+    def __init__(self) -> None:
+        super().__init__()
+        self.count = 0
+
+    def for_each(self, node: pugi.XMLNode) -> bool:  # noqa: ARG002
+        self.count += 1
+        return True
+
+
+def _walk_siblings(root: pugi.XMLNode) -> int:
+    count = 0
+    node = root.first_child()
+    while node:
+        count += 1
+        child = node.first_child()
+        if child:
+            node = child
+            continue
+        while node != root and not node.next_sibling():
+            node = node.parent()
+        node = node.next_sibling() if node != root else pugi.XMLNode()
+    return count
+
+
+def test_children(
+    benchmark: BenchmarkFixture, document: pugi.XMLDocument
+) -> None:
+    root = document.document_element()
+
+    def iterate() -> int:
+        return sum(1 for _ in root.children())
+
+    count = benchmark(iterate)
+    assert count > 0
+    benchmark.extra_info["nodes"] = count
+
+
+def test_children_name(
+    benchmark: BenchmarkFixture, document: pugi.XMLDocument
+) -> None:
+    root = document.document_element()
+    name = root.first_child().name()
+
+    def iterate() -> int:
+        return sum(1 for _ in root.children(name))
+
+    count = benchmark(iterate)
+    assert count > 0
+    benchmark.extra_info["nodes"] = count
+
+
+def test_first_child_next_sibling(
+    benchmark: BenchmarkFixture, document: pugi.XMLDocument
+) -> None:
+    count = benchmark(_walk_siblings, document)
+    assert count > 0
+    benchmark.extra_info["nodes"] = count
+
+
+def test_names_and_attributes(
+    benchmark: BenchmarkFixture, document: pugi.XMLDocument
+) -> None:
+    root = document.document_element()
+
+    def iterate() -> int:
+        count = 0
+        for node in root.children():
+            node.name()
+            for attr in node.attributes():
+                attr.name()
+                attr.value()
+                count += 1
+        return count
+
+    benchmark.extra_info["attributes"] = benchmark(iterate)
+
+
+def test_traverse(
+    benchmark: BenchmarkFixture, document: pugi.XMLDocument
+) -> None:
+    def traverse() -> int:
+        walker = _CountingWalker()
+        document.traverse(walker)
+        return walker.count
+
+    count = benchmark(traverse)
+    assert count > 0
+    benchmark.extra_info["nodes"] = count
+
+
+def test_text_values(
+    benchmark: BenchmarkFixture, document: pugi.XMLDocument
+) -> None:
+    nodes = [
+        node.node() for node in document.select_nodes("//text()[. != '']")
+    ]
+
+    def iterate() -> int:
+        return sum(len(node.value()) for node in nodes)
+
+    benchmark.extra_info["characters"] = benchmark(iterate)
@@ -0,0 +1,53 @@
+from __future__ import annotations
+
+from typing import TYPE_CHECKING
+
+import pytest
+
+from pugixml import pugi
+
+from .corpus import XPATH_QUERIES
+
+if TYPE_CHECKING:
+    from pytest_benchmark.fixture import BenchmarkFixture
+
+    from .conftest import Corpus
+
+
+@pytest.fixture
+def query(corpus: Corpus) -> str:
+    return XPATH_QUERIES[corpus.kind]
+
+
+def test_find_node(
+    benchmark: BenchmarkFixture, document: pugi.XMLDocument
+) -> None:
+    def find() -> pugi.XMLNode:
+        return document.find_node(lambda node: False)  # noqa: ARG005
+
+    assert benchmark(find).empty()
+
+
+def test_select_node(
+    benchmark: BenchmarkFixture, document: pugi.XMLDocument, query: str
+) -> None:
+    benchmark(document.select_node, query)
+
+
+def test_select_nodes(
+    benchmark: BenchmarkFixture, document: pugi.XMLDocument, query: str
+) -> None:
+    nodes = benchmark(document.select_nodes, query)
+    benchmark.extra_info["nodes"] = len(nodes)
+
+
+def test_select_nodes_compiled(
+    benchmark: BenchmarkFixture, document: pugi.XMLDocument, query: str
+) -> None:
+    compiled = pugi.XPathQuery(query)
+    nodes = benchmark(compiled.evaluate_node_set, document)
+    benchmark.extra_info["nodes"] = len(nodes)
+
+
+def test_xpath_compile(benchmark: BenchmarkFixture, query: str) -> None:
+    assert benchmark(pugi.XPathQuery, query)
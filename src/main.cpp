@@ -1,9 +1,20 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <pugixml.hpp>
 #include <pybind11/functional.h>
@@ -11,7 +22,22 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 #include <pybind11/stl/filesystem.h>
+#include <random>
+#include <set>
 #include <sstream>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#ifdef PUGIXML_ZLIB
+#include <zlib.h>
+#endif // PUGIXML_ZLIB
+#ifdef PUGIXML_ZSTD
+#include <zstd.h>
+#endif // PUGIXML_ZSTD
 
 #ifndef MODULE_NAME
 #error MODULE_NAME was not defined.
@@ -58,6 +84,34 @@ static std::map<int, const char *> _xml_parse_status_to_string{
     {status_no_document_element, "STATUS_NO_DOCUMENT_ELEMENT"},
 };
 
+// Build a Python string directly from the internal representation of pugixml.
+static py::str to_str(const char_t *value, size_t length) {
+#ifdef PUGIXML_WCHAR_MODE
+  // wchar_t is UTF-32 (UCS-4 kind) on most platforms, and UTF-16 on Windows.
+  const auto result =
+      sizeof(wchar_t) == 4
+          ? PyUnicode_FromKindAndData(PyUnicode_4BYTE_KIND, value, static_cast<Py_ssize_t>(length))
+          : PyUnicode_FromWideChar(value, static_cast<Py_ssize_t>(length));
+#else
+  const auto result = PyUnicode_DecodeUTF8(value, static_cast<Py_ssize_t>(length), nullptr);
+#endif // PUGIXML_WCHAR_MODE
+  if (!result) {
+    throw py::error_already_set();
+  }
+  return py::reinterpret_steal<py::str>(result);
+}
+
+static py::str to_str(const char_t *value) { return to_str(value, std::char_traits<char_t>::length(value)); }
+
+// Convert a string of pugixml to UTF-8 for messages and repr().
+static std::string to_utf8(const char_t *value) {
+#ifdef PUGIXML_WCHAR_MODE
+  return as_utf8(value);
+#else
+  return value;
+#endif // PUGIXML_WCHAR_MODE
+}
+
 struct XMLAttributeStruct {
   xml_attribute_struct *p_;
   XMLAttributeStruct(xml_attribute_struct *p) : p_(p) {}
@@ -77,19 +131,6 @@ template <typename iterator, typename vartype> struct Iterator {
 
   Iterator(const xml_object_range<iterator> &it) : items_(it.begin(), it.end()), index_(0) {}
 
-  auto get(const py::slice &slice) {
-    size_t start = 0, stop = 0, step = 0, slice_length = 0;
-    if (!slice.compute(size(), &start, &stop, &step, &slice_length)) {
-      throw py::error_already_set();
-    }
-    auto result = new std::vector<vartype>(slice_length);
-    for (size_t n = 0; n < slice_length; ++n) {
-      (*result)[n] = items_[start];
-      start += step;
-    }
-    return result;
-  }
-
   vartype &operator[](long long n) {
     if (n < 0) {
       n += size();
@@ -104,12 +145,2931 @@ template <typename iterator, typename vartype> struct Iterator {
     if (index_ >= size()) {
       throw py::stop_iteration();
     }
-    return items_[index_++];
+    return items_[index_++];
+  }
+
+  void reset() { index_ = 0; }
+
+  auto size() const { return items_.size(); }
+};
+
+// Return the list of items at *slice* of *self* by calling __getitem__(index) of *self*, so that each item keeps
+// *self* alive (keep_alive can not be applied to the list).
+static py::list get_slice(const py::object &self, const py::slice &slice) {
+  size_t start = 0, stop = 0, step = 0, slice_length = 0;
+  if (!slice.compute(py::len(self), &start, &stop, &step, &slice_length)) {
+    throw py::error_already_set();
+  }
+  const auto getitem = self.attr("__getitem__");
+  py::list result(slice_length);
+  for (size_t n = 0; n < slice_length; ++n) {
+    result[n] = getitem(start);
+    start += step;
+  }
+  return result;
+}
+
+// Memory management functions for pugixml: every block starts with MemoryBlock that records the backend
+// that allocated it, so the blocks are always released by their own backend even if the allocator is changed.
+class MemoryBackend;
+
+struct alignas(16) MemoryBlock {
+  MemoryBackend *backend;
+  uintptr_t context;
+  size_t size;
+  size_t capacity;
+};
+
+class MemoryBackend {
+public:
+  explicit MemoryBackend(const char *name) : name_(name) {}
+  virtual ~MemoryBackend() = default;
+
+  // Return the block of at least *size* bytes with backend/context set, or nullptr.
+  virtual MemoryBlock *allocate(size_t size) = 0;
+
+  virtual void deallocate(MemoryBlock *block) = 0;
+
+  // Release the cached memory to the system.
+  virtual void trim() {}
+
+  const char *name() const { return name_; }
+
+  std::atomic<uint64_t> reserved_bytes_{0};
+
+private:
+  const char *name_;
+};
+
+// Allocate each block with malloc().
+class SystemBackend : public MemoryBackend {
+public:
+  SystemBackend() : MemoryBackend("system") {}
+
+  MemoryBlock *allocate(size_t size) override {
+    auto block = static_cast<MemoryBlock *>(std::malloc(size));
+    if (block) {
+      block->backend = this;
+      block->context = size;
+      reserved_bytes_ += size;
+    }
+    return block;
+  }
+
+  void deallocate(MemoryBlock *block) override {
+    reserved_bytes_ -= block->context;
+    std::free(block);
+  }
+};
+
+// Bump allocator: blocks are carved out of large chunks, and a chunk is released when all of its blocks are freed.
+class ArenaBackend : public MemoryBackend {
+public:
+  ArenaBackend() : MemoryBackend("arena") {}
+
+  MemoryBlock *allocate(size_t size) override {
+    size = (size + alignof(MemoryBlock) - 1) & ~(alignof(MemoryBlock) - 1);
+    std::lock_guard<std::mutex> lock(mutex_);
+    Chunk *chunk = nullptr;
+    if (size > chunk_size_ / 4) {
+      chunk = new_chunk(size);
+    } else {
+      if (!current_ || current_->offset + size > current_->capacity) {
+        auto fresh = new_chunk(chunk_size_);
+        if (!fresh) {
+          return nullptr;
+        }
+        retire_current();
+        current_ = fresh;
+      }
+      chunk = current_;
+    }
+    if (!chunk) {
+      return nullptr;
+    }
+    auto block = reinterpret_cast<MemoryBlock *>(reinterpret_cast<char *>(chunk + 1) + chunk->offset);
+    chunk->offset += size;
+    ++chunk->blocks;
+    block->backend = this;
+    block->context = reinterpret_cast<uintptr_t>(chunk);
+    return block;
+  }
+
+  void deallocate(MemoryBlock *block) override {
+    auto chunk = reinterpret_cast<Chunk *>(block->context);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--chunk->blocks != 0) {
+      return;
+    }
+    if (chunk == current_) {
+      chunk->offset = 0;
+    } else {
+      free_chunk(chunk);
+    }
+  }
+
+  void trim() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    retire_current();
+  }
+
+private:
+  struct alignas(16) Chunk {
+    size_t capacity;
+    size_t offset;
+    size_t blocks;
+  };
+
+  Chunk *new_chunk(size_t capacity) {
+    auto chunk = static_cast<Chunk *>(std::malloc(sizeof(Chunk) + capacity));
+    if (chunk) {
+      chunk->capacity = capacity;
+      chunk->offset = 0;
+      chunk->blocks = 0;
+      reserved_bytes_ += sizeof(Chunk) + capacity;
+    }
+    return chunk;
+  }
+
+  void free_chunk(Chunk *chunk) {
+    reserved_bytes_ -= sizeof(Chunk) + chunk->capacity;
+    std::free(chunk);
+  }
+
+  void retire_current() {
+    if (current_ && current_->blocks == 0) {
+      free_chunk(current_);
+    }
+    current_ = nullptr;
+  }
+
+  static constexpr size_t chunk_size_ = 1024 * 1024;
+  std::mutex mutex_;
+  Chunk *current_ = nullptr;
+};
+
+// Size-class pool: freed blocks are kept in per-class free lists (up to max_cached_bytes_) and reused.
+class PoolBackend : public MemoryBackend {
+public:
+  PoolBackend() : MemoryBackend("pool") {}
+
+  MemoryBlock *allocate(size_t size) override {
+    const auto index = size_class(size);
+    if (index >= classes_) {
+      auto block = static_cast<MemoryBlock *>(std::malloc(size));
+      if (block) {
+        block->backend = this;
+        block->context = classes_;
+        reserved_bytes_ += size;
+      }
+      return block;
+    }
+    const auto class_size = class_bytes(index);
+    MemoryBlock *block = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (free_lists_[index]) {
+        block = free_lists_[index];
+        free_lists_[index] = *reinterpret_cast<MemoryBlock **>(block + 1);
+        cached_bytes_ -= class_size;
+      }
+    }
+    if (!block) {
+      block = static_cast<MemoryBlock *>(std::malloc(class_size));
+      if (!block) {
+        return nullptr;
+      }
+      reserved_bytes_ += class_size;
+    }
+    block->backend = this;
+    block->context = index;
+    return block;
+  }
+
+  void deallocate(MemoryBlock *block) override {
+    const auto index = block->context;
+    if (index >= classes_) {
+      reserved_bytes_ -= sizeof(MemoryBlock) + block->capacity;
+      std::free(block);
+      return;
+    }
+    const auto class_size = class_bytes(index);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (cached_bytes_ + class_size <= max_cached_bytes_) {
+        *reinterpret_cast<MemoryBlock **>(block + 1) = free_lists_[index];
+        free_lists_[index] = block;
+        cached_bytes_ += class_size;
+        return;
+      }
+    }
+    reserved_bytes_ -= class_size;
+    std::free(block);
+  }
+
+  void trim() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &head : free_lists_) {
+      while (head) {
+        auto next = *reinterpret_cast<MemoryBlock **>(head + 1);
+        reserved_bytes_ -= class_bytes(head->context);
+        std::free(head);
+        head = next;
+      }
+    }
+    cached_bytes_ = 0;
+  }
+
+private:
+  // Size classes: 64-byte steps up to 4 KiB, then 4 KiB steps up to 256 KiB.
+  static size_t size_class(size_t size) {
+    if (size <= 4096) {
+      return size == 0 ? 0 : (size - 1) / 64;
+    }
+    return 64 + (size - 4096 - 1) / 4096;
+  }
+
+  static size_t class_bytes(size_t index) { return index < 64 ? (index + 1) * 64 : 4096 + (index - 63) * 4096; }
+
+  static constexpr size_t classes_ = 64 + 63;
+  static constexpr size_t max_cached_bytes_ = 64 * 1024 * 1024;
+  std::mutex mutex_;
+  MemoryBlock *free_lists_[classes_] = {};
+  size_t cached_bytes_ = 0;
+};
+
+// Counters of the memory allocated by pugixml.
+struct MemoryStats {
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> deallocations{0};
+  std::atomic<uint64_t> bytes_allocated{0};
+  std::atomic<uint64_t> live_blocks{0};
+  std::atomic<uint64_t> live_bytes{0};
+  std::atomic<uint64_t> peak_bytes{0};
+  std::atomic<uint64_t> reused_blocks{0};
+};
+
+// The backends are never destroyed, since the documents may outlive the module at interpreter shutdown.
+static MemoryBackend *const _memory_backends[] = {new SystemBackend(), new ArenaBackend(), new PoolBackend()};
+static std::atomic<MemoryBackend *> _memory_backend{_memory_backends[0]};
+static MemoryStats _memory_stats;
+
+// Live memory blocks (address -> size) to find the blocks referenced by a document tree. The blocks are registered
+// only while pugi.memory.set_block_tracking() is enabled, so that the allocations do not take the lock by default.
+static auto *const _memory_blocks = new std::map<uintptr_t, size_t>();
+static auto *const _memory_blocks_mutex = new std::mutex();
+static std::atomic<bool> _block_tracking{false};
+static std::atomic<size_t> _tracked_blocks{0};
+
+// Memory blocks retained by XMLDocument.reset(keep_memory=True) for reuse (capacity -> block), guarded by
+// _retained_blocks_mutex; _retained_bytes is also read without the lock to skip it when nothing is retained.
+static auto *const _retained_blocks = new std::multimap<size_t, MemoryBlock *>();
+static auto *const _retained_blocks_mutex = new std::mutex();
+static std::atomic<size_t> _retained_bytes{0};
+static constexpr size_t _retained_limit = 64 * 1024 * 1024;
+static thread_local bool _retain_memory = false;
+
+// tracemalloc domain of the memory blocks allocated by pugixml. The tracked blocks are recorded, so that they are
+// untracked when they are released, or when the tracking is disabled.
+static constexpr unsigned int _tracemalloc_domain = 0x50554749;
+static std::atomic<bool> _tracemalloc_enabled{false};
+static auto *const _tracemalloc_blocks = new std::set<uintptr_t>();
+static auto *const _tracemalloc_blocks_mutex = new std::mutex();
+static std::atomic<size_t> _tracemalloc_tracked{0};
+
+// Operations measured by pugixml.pugi.stats.
+enum class Operation { load, save, select, traverse, compile };
+
+static constexpr const char *_operation_names[] = {"load", "save", "select", "traverse", "compile"};
+
+struct OperationStats {
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> nodes{0};
+  std::atomic<uint64_t> time_ns{0};
+  std::atomic<uint64_t> allocations{0};
+  std::atomic<uint64_t> allocated_bytes{0};
+};
+
+static OperationStats _operation_stats[std::size(_operation_names)];
+static std::atomic<bool> _stats_enabled{false};
+
+// Allocations made by the current thread; the difference over an operation is attributed to it.
+static thread_local uint64_t _thread_allocations = 0;
+static thread_local uint64_t _thread_allocated_bytes = 0;
+static thread_local uint64_t _thread_deallocated_bytes = 0;
+
+static void *allocate_memory(size_t size) {
+  if (size > std::numeric_limits<size_t>::max() - sizeof(MemoryBlock)) {
+    return nullptr;
+  }
+  MemoryBlock *block = nullptr;
+  if (_retained_bytes.load(std::memory_order_relaxed) > 0) {
+    std::lock_guard<std::mutex> lock(*_retained_blocks_mutex);
+    const auto it = _retained_blocks->lower_bound(size);
+    if (it != _retained_blocks->end() && it->first / 2 <= size) {
+      block = it->second;
+      _retained_bytes -= it->first;
+      _retained_blocks->erase(it);
+      _memory_stats.reused_blocks.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  if (!block) {
+    block = _memory_backend.load(std::memory_order_relaxed)->allocate(sizeof(MemoryBlock) + size);
+    if (!block) {
+      return nullptr;
+    }
+    block->capacity = size;
+  }
+  block->size = size;
+  ++_thread_allocations;
+  _thread_allocated_bytes += size;
+  _memory_stats.allocations.fetch_add(1, std::memory_order_relaxed);
+  _memory_stats.bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+  _memory_stats.live_blocks.fetch_add(1, std::memory_order_relaxed);
+  const auto live_bytes = _memory_stats.live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+  auto peak_bytes = _memory_stats.peak_bytes.load(std::memory_order_relaxed);
+  while (live_bytes > peak_bytes &&
+         !_memory_stats.peak_bytes.compare_exchange_weak(peak_bytes, live_bytes, std::memory_order_relaxed)) {
+  }
+  const auto ptr = block + 1;
+  if (_block_tracking.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(*_memory_blocks_mutex);
+    if (_memory_blocks->emplace(reinterpret_cast<uintptr_t>(ptr), size).second) {
+      ++_tracked_blocks;
+    }
+  }
+  // PyTraceMalloc_Track() may take the GIL, so it is not called under the lock.
+  if (_tracemalloc_enabled.load(std::memory_order_relaxed) && Py_IsInitialized() &&
+      PyTraceMalloc_Track(_tracemalloc_domain, reinterpret_cast<uintptr_t>(ptr), size) == 0) {
+    std::lock_guard<std::mutex> lock(*_tracemalloc_blocks_mutex);
+    if (_tracemalloc_blocks->insert(reinterpret_cast<uintptr_t>(ptr)).second) {
+      ++_tracemalloc_tracked;
+    }
+  }
+  return ptr;
+}
+
+static void deallocate_memory(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  // The blocks tracked before the tracking is disabled are still untracked.
+  if (_tracemalloc_tracked.load() > 0) {
+    bool tracked = false;
+    {
+      std::lock_guard<std::mutex> lock(*_tracemalloc_blocks_mutex);
+      if (_tracemalloc_blocks->erase(reinterpret_cast<uintptr_t>(ptr))) {
+        --_tracemalloc_tracked;
+        tracked = true;
+      }
+    }
+    if (tracked && Py_IsInitialized()) {
+      PyTraceMalloc_Untrack(_tracemalloc_domain, reinterpret_cast<uintptr_t>(ptr));
+    }
+  }
+  auto block = static_cast<MemoryBlock *>(ptr) - 1;
+  _thread_deallocated_bytes += block->size;
+  _memory_stats.deallocations.fetch_add(1, std::memory_order_relaxed);
+  _memory_stats.live_blocks.fetch_sub(1, std::memory_order_relaxed);
+  _memory_stats.live_bytes.fetch_sub(block->size, std::memory_order_relaxed);
+  // The blocks registered before the tracking is disabled are still unregistered.
+  if (_tracked_blocks.load() > 0) {
+    std::lock_guard<std::mutex> lock(*_memory_blocks_mutex);
+    if (_memory_blocks->erase(reinterpret_cast<uintptr_t>(ptr))) {
+      --_tracked_blocks;
+    }
+  }
+  if (_retain_memory) {
+    std::lock_guard<std::mutex> lock(*_retained_blocks_mutex);
+    if (_retained_bytes + block->capacity <= _retained_limit) {
+      _retained_blocks->emplace(block->capacity, block);
+      _retained_bytes += block->capacity;
+      return;
+    }
+  }
+  block->backend->deallocate(block);
+}
+
+// Enable or disable the tracking in tracemalloc; the tracked blocks are untracked when the tracking is disabled.
+static void set_tracemalloc(bool enabled) {
+  _tracemalloc_enabled = enabled;
+  if (enabled) {
+    return;
+  }
+  std::set<uintptr_t> blocks;
+  {
+    std::lock_guard<std::mutex> lock(*_tracemalloc_blocks_mutex);
+    blocks.swap(*_tracemalloc_blocks);
+    _tracemalloc_tracked -= blocks.size();
+  }
+  for (const auto address : blocks) {
+    PyTraceMalloc_Untrack(_tracemalloc_domain, address);
+  }
+}
+
+// Release the memory blocks retained for reuse.
+static void release_retained_blocks() {
+  std::multimap<size_t, MemoryBlock *> blocks;
+  {
+    std::lock_guard<std::mutex> lock(*_retained_blocks_mutex);
+    blocks.swap(*_retained_blocks);
+    _retained_bytes = 0;
+  }
+  for (const auto &item : blocks) {
+    item.second->backend->deallocate(item.second);
+  }
+}
+
+// Record an operation in pugixml.pugi.stats from construction to destruction while the counters are enabled.
+class ScopedOperation {
+public:
+  explicit ScopedOperation(Operation operation)
+      : stats_(_stats_enabled.load(std::memory_order_relaxed) ? &_operation_stats[static_cast<size_t>(operation)]
+                                                               : nullptr) {
+    if (stats_) {
+      allocations_ = _thread_allocations;
+      allocated_bytes_ = _thread_allocated_bytes;
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+  ScopedOperation(const ScopedOperation &) = delete;
+  ScopedOperation &operator=(const ScopedOperation &) = delete;
+  ~ScopedOperation() {
+    if (!stats_) {
+      return;
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start_;
+    stats_->calls.fetch_add(1, std::memory_order_relaxed);
+    stats_->bytes.fetch_add(bytes_, std::memory_order_relaxed);
+    stats_->nodes.fetch_add(nodes_, std::memory_order_relaxed);
+    stats_->time_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                              std::memory_order_relaxed);
+    stats_->allocations.fetch_add(_thread_allocations - allocations_, std::memory_order_relaxed);
+    stats_->allocated_bytes.fetch_add(_thread_allocated_bytes - allocated_bytes_, std::memory_order_relaxed);
+  }
+
+  void add_bytes(uint64_t bytes) { bytes_ += bytes; }
+
+  void add_nodes(uint64_t nodes) { nodes_ += nodes; }
+
+private:
+  OperationStats *stats_;
+  uint64_t bytes_ = 0;
+  uint64_t nodes_ = 0;
+  uint64_t allocations_ = 0;
+  uint64_t allocated_bytes_ = 0;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Compile the XPath expression; the compilation is recorded in pugixml.pugi.stats.
+static std::unique_ptr<xpath_query> compile_xpath_query(const char_t *query, xpath_variable_set *variables) {
+  ScopedOperation operation(Operation::compile);
+  operation.add_bytes(std::char_traits<char_t>::length(query) * sizeof(char_t));
+  return std::make_unique<xpath_query>(query, variables);
+}
+
+// Count the bytes written to another writer.
+class CountingWriter : public xml_writer {
+public:
+  explicit CountingWriter(xml_writer &writer) : writer_(writer) {}
+
+  void write(const void *data, size_t size) override {
+    bytes_ += size;
+    writer_.write(data, size);
+  }
+
+  uint64_t bytes() const { return bytes_; }
+
+private:
+  xml_writer &writer_;
+  uint64_t bytes_ = 0;
+};
+
+// Memory usage of the document tree: the sizes of the node/attribute structures are estimated from their layouts.
+class MemoryUsage {
+public:
+#ifdef PUGIXML_COMPACT
+  static constexpr size_t node_size = 12;
+  static constexpr size_t attribute_size = 8;
+#else
+  static constexpr size_t node_size = 8 * sizeof(void *);
+  static constexpr size_t attribute_size = 5 * sizeof(void *);
+#endif // PUGIXML_COMPACT
+
+  MemoryUsage() {
+    std::lock_guard<std::mutex> lock(*_memory_blocks_mutex);
+    blocks_ = *_memory_blocks;
+  }
+
+  void add_tree(const xml_node &root) {
+    for (auto node = root.first_child(); node;) {
+      add_node(node);
+      if (node.first_child()) {
+        node = node.first_child();
+        continue;
+      }
+      while (node != root && !node.next_sibling()) {
+        node = node.parent();
+      }
+      node = node == root ? xml_node() : node.next_sibling();
+    }
+  }
+
+  size_t page_bytes() const {
+    size_t result = 0;
+    for (const auto address : used_blocks_) {
+      result += blocks_.at(address);
+    }
+    return result;
+  }
+
+  py::dict result() const {
+    const auto page_bytes = this->page_bytes();
+    const auto struct_bytes = nodes_ * node_size + attributes_ * attribute_size;
+    const auto used_bytes = struct_bytes + string_bytes_;
+    py::dict result;
+    result["nodes"] = nodes_;
+    result["attributes"] = attributes_;
+    result["struct_bytes"] = struct_bytes;
+    result["string_bytes"] = string_bytes_;
+    result["blocks"] = used_blocks_.size();
+    result["page_bytes"] = page_bytes;
+    result["wasted_bytes"] = page_bytes > used_bytes ? page_bytes - used_bytes : 0;
+    return result;
+  }
+
+private:
+  void add_node(const xml_node &node) {
+    ++nodes_;
+    add_object(node.internal_object());
+    add_string(node.name());
+    add_string(node.value());
+    for (const auto &attr : node.attributes()) {
+      ++attributes_;
+      add_object(attr.internal_object());
+      add_string(attr.name());
+      add_string(attr.value());
+    }
+  }
+
+  void add_object(const void *object) {
+    const auto address = reinterpret_cast<uintptr_t>(object);
+    auto it = blocks_.upper_bound(address);
+    if (it == blocks_.begin()) {
+      return;
+    }
+    --it;
+    if (address < it->first + it->second) {
+      used_blocks_.insert(it->first);
+    }
+  }
+
+  void add_string(const char_t *value) {
+    if (*value) {
+      add_object(value);
+      string_bytes_ += (std::char_traits<char_t>::length(value) + 1) * sizeof(char_t);
+    }
+  }
+
+  std::map<uintptr_t, size_t> blocks_;
+  std::set<uintptr_t> used_blocks_;
+  size_t nodes_ = 0;
+  size_t attributes_ = 0;
+  size_t string_bytes_ = 0;
+};
+
+static std::map<std::string, char> _column_type_to_typecode{
+    {"bool", 'B'}, {"double", 'd'}, {"float", 'f'}, {"int", 'i'},
+    {"llong", 'q'}, {"string", 0},  {"uint", 'I'},  {"ullong", 'Q'},
+};
+
+// Convert the result of XPath number to the C++ type (NaN -> 0, out-of-range values are clamped).
+template <typename T> T number_cast(double value) {
+  if (std::isnan(value)) {
+    return T();
+  }
+  if (value <= static_cast<double>(std::numeric_limits<T>::lowest())) {
+    return std::numeric_limits<T>::lowest();
+  }
+  if (value >= static_cast<double>(std::numeric_limits<T>::max())) {
+    return std::numeric_limits<T>::max();
+  }
+  return static_cast<T>(value);
+}
+
+// A single column of XMLNode.extract_columns()
+struct Column {
+  py::object name_;
+  std::unique_ptr<xpath_query> query_;
+  char typecode_;
+  std::string data_; // array.array contents (typecode_ != 0)
+  py::list values_;  // str values (typecode_ == 0)
+
+  Column(const py::handle &name, const char_t *query, char typecode)
+      : name_(py::reinterpret_borrow<py::object>(name)), query_(std::make_unique<xpath_query>(query)),
+        typecode_(typecode) {}
+
+  template <typename T> void append(T value) { data_.append(reinterpret_cast<const char *>(&value), sizeof(T)); }
+
+  template <typename T> void extract_value(const T &value) {
+    switch (typecode_) {
+    case 'B':
+      append<unsigned char>(value.as_bool());
+      break;
+    case 'd':
+      append(value.as_double());
+      break;
+    case 'f':
+      append(value.as_float());
+      break;
+    case 'i':
+      append(value.as_int());
+      break;
+    case 'I':
+      append(value.as_uint());
+      break;
+    case 'q':
+      append(value.as_llong());
+      break;
+    case 'Q':
+      append(value.as_ullong());
+      break;
+    default:
+      values_.append(value.as_string());
+      break;
+    }
+  }
+
+  void extract_number(double value) {
+    switch (typecode_) {
+    case 'd':
+      append(value);
+      break;
+    case 'f':
+      append(static_cast<float>(value));
+      break;
+    case 'i':
+      append(number_cast<int>(value));
+      break;
+    case 'I':
+      append(number_cast<unsigned int>(value));
+      break;
+    case 'q':
+      append(number_cast<long long>(value));
+      break;
+    case 'Q':
+      append(number_cast<unsigned long long>(value));
+      break;
+    }
+  }
+
+  void extract(const xml_node &record) {
+    if (query_->return_type() == xpath_type_node_set) {
+      const auto found = query_->evaluate_node(record);
+      if (found.attribute()) {
+        extract_value(found.attribute());
+      } else {
+        extract_value(found.node().text());
+      }
+    } else if (typecode_ == 0) {
+      values_.append(query_->evaluate_string(record));
+    } else if (typecode_ == 'B') {
+      append<unsigned char>(query_->evaluate_boolean(record));
+    } else {
+      extract_number(query_->evaluate_number(record));
+    }
+  }
+
+  py::object result(const py::handle &array) const {
+    if (typecode_ == 0) {
+      return values_;
+    }
+    return array(std::string(1, typecode_), py::bytes(data_));
+  }
+};
+
+// Convert a number in [first, last) surrounded by optional whitespace; return false if it is not a valid number.
+//
+// The integers are decimal or hexadecimal with the "0x" prefix, as in XMLAttribute.as_int(), etc.; unlike them, the
+// values that are out of range or followed by other characters are errors.
+template <typename T> static bool parse_number(const char *first, const char *last, T &value) {
+  const auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+  while (first < last && is_space(*first)) {
+    ++first;
+  }
+  while (last > first && is_space(last[-1])) {
+    --last;
+  }
+  if (last - first > 1 && *first == '+' && first[1] != '-') {
+    ++first;
+  }
+  if (first == last) {
+    return false;
+  }
+  if constexpr (std::is_integral_v<T>) {
+    // The sign precedes the "0x" prefix (e.g. "-0x10"); a sign after the prefix is an error.
+    const auto negative = *first == '-';
+    const auto digits = negative ? first + 1 : first;
+    if (last - digits > 2 && digits[0] == '0' && (digits[1] | 0x20) == 'x') {
+      using Unsigned = std::make_unsigned_t<T>;
+      Unsigned magnitude = 0;
+      const auto [ptr, ec] = std::from_chars(digits + 2, last, magnitude, 16);
+      if (ec != std::errc() || ptr != last) {
+        return false;
+      }
+      const auto max = static_cast<Unsigned>(std::numeric_limits<T>::max());
+      if (!negative) {
+        if (magnitude > max) {
+          return false;
+        }
+        value = static_cast<T>(magnitude);
+        return true;
+      }
+      if constexpr (std::is_signed_v<T>) {
+        if (magnitude > max + 1) {
+          return false;
+        }
+        value = magnitude == max + 1 ? std::numeric_limits<T>::min() : static_cast<T>(-static_cast<T>(magnitude));
+        return true;
+      } else {
+        return false;
+      }
+    }
+    const auto [ptr, ec] = std::from_chars(first, last, value);
+    return ec == std::errc() && ptr == last;
+  } else {
+#if defined(__cpp_lib_to_chars)
+    const auto [ptr, ec] = std::from_chars(first, last, value);
+    return ec == std::errc() && ptr == last;
+#else
+    // Floating-point std::from_chars() is not available in this standard library.
+    const std::string text(first, last);
+    char *end = nullptr;
+    errno = 0;
+    if constexpr (std::is_same_v<T, float>) {
+      value = std::strtof(text.c_str(), &end);
+    } else {
+      value = std::strtod(text.c_str(), &end);
+    }
+    return errno != ERANGE && end == text.c_str() + text.size();
+#endif // defined(__cpp_lib_to_chars)
+  }
+}
+
+// Typed buffer of pugixml.pugi.parse_numbers() with the indices of the values that are not valid numbers.
+template <typename T> class NumberParser {
+public:
+  void append(const char *first, const char *last) {
+    T value{};
+    if (!parse_number(first, last, value)) {
+      errors_.push_back(count_);
+      value = T();
+    }
+    data_.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    ++count_;
+  }
+
+  void append(const char_t *value) {
+#ifdef PUGIXML_WCHAR_MODE
+    const auto text = as_utf8(value);
+    append(text.data(), text.data() + text.size());
+#else
+    append(value, value + std::strlen(value));
+#endif // PUGIXML_WCHAR_MODE
+  }
+
+  void append(const xpath_node &node) {
+    if (node.attribute()) {
+      append(node.attribute().value());
+    } else {
+      append(node.node().text().get());
+    }
+  }
+
+  void append(const py::handle &item) {
+    if (PyUnicode_Check(item.ptr())) {
+      Py_ssize_t size = 0;
+      const auto text = PyUnicode_AsUTF8AndSize(item.ptr(), &size);
+      if (!text) {
+        throw py::error_already_set();
+      }
+      append(text, text + size);
+    } else if (py::isinstance<xml_attribute>(item)) {
+      append(item.cast<const xml_attribute &>().value());
+    } else if (py::isinstance<xml_text>(item)) {
+      append(item.cast<const xml_text &>().get());
+    } else if (py::isinstance<xml_node>(item)) {
+      append(item.cast<const xml_node &>().text().get());
+    } else if (py::isinstance<xpath_node>(item)) {
+      append(item.cast<const xpath_node &>());
+    } else {
+      throw py::type_error("expected str, XMLAttribute, XMLNode, XMLText or XPathNode, not " +
+                           std::string(Py_TYPE(item.ptr())->tp_name));
+    }
+  }
+
+  py::tuple result(char typecode) const {
+    const auto array = py::module_::import("array").attr("array");
+    py::list errors;
+    for (const auto index : errors_) {
+      errors.append(index);
+    }
+    return py::make_tuple(array(std::string(1, typecode), py::bytes(data_)), errors);
+  }
+
+private:
+  std::string data_;
+  std::vector<size_t> errors_;
+  size_t count_ = 0;
+};
+
+template <typename T> static py::tuple parse_numbers(const py::handle &values, char typecode) {
+  NumberParser<T> parser;
+  if (py::isinstance<xpath_node_set>(values)) {
+    // The GIL is kept: another thread could modify the node set or the document during the conversion.
+    for (const auto &node : values.cast<const xpath_node_set &>()) {
+      parser.append(node);
+    }
+  } else {
+    if (!py::isinstance<py::iterable>(values)) {
+      throw py::type_error("values must be iterable, not " + std::string(Py_TYPE(values.ptr())->tp_name));
+    }
+    for (const auto &item : py::reinterpret_borrow<py::iterable>(values)) {
+      parser.append(item);
+    }
+  }
+  return parser.result(typecode);
+}
+
+// Binary DOM snapshot of XMLDocument.
+//
+// The snapshot consists of the following sections in native byte order:
+//   SnapshotHeader
+//   uint32_t lengths[strings]                 ; the string lengths in char_t units (string #0 is the empty string)
+//   char_t data[string_units]                 ; the NUL-terminated strings
+//   SnapshotNode nodes[nodes]                 ; the nodes in document order (node #0 is the document node)
+//   SnapshotAttribute attributes[attributes]  ; the attributes in document order
+// Each section is aligned to 8 bytes. All references are indices, so the snapshot can be loaded from any address
+// (e.g., shared memory or memory-mapped file). Any data after the last section is ignored.
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t char_size;
+  uint32_t reserved;
+  uint64_t strings;
+  uint64_t string_units;
+  uint64_t nodes;
+  uint64_t attributes;
+};
+
+struct SnapshotNode {
+  uint32_t type;
+  uint32_t name;
+  uint32_t value;
+  uint32_t attributes;
+  uint32_t children;
+};
+
+struct SnapshotAttribute {
+  uint32_t name;
+  uint32_t value;
+};
+
+static constexpr char _snapshot_magic[8] = {'P', 'U', 'G', 'I', 'S', 'N', 'A', 'P'};
+static constexpr uint32_t _snapshot_version = 1;
+static constexpr uint32_t _snapshot_byte_order = 0x01020304;
+
+static uint64_t snapshot_align(uint64_t size) { return (size + 7) & ~static_cast<uint64_t>(7); }
+
+class SnapshotBuilder {
+public:
+  SnapshotBuilder() : lengths_{0}, data_(1, 0) {}
+
+  void add_tree(const xml_node &root) {
+    add_node(root);
+    for (auto node = root.first_child(); node;) {
+      add_node(node);
+      if (node.first_child()) {
+        node = node.first_child();
+        continue;
+      }
+      while (node != root && !node.next_sibling()) {
+        node = node.parent();
+      }
+      node = node == root ? xml_node() : node.next_sibling();
+    }
+  }
+
+  // Return the size of the snapshot in bytes.
+  size_t size() const {
+    return sizeof(SnapshotHeader) + snapshot_align(lengths_.size() * sizeof(uint32_t)) +
+           snapshot_align(data_.size() * sizeof(char_t)) + snapshot_align(nodes_.size() * sizeof(SnapshotNode)) +
+           snapshot_align(attributes_.size() * sizeof(SnapshotAttribute));
+  }
+
+  // Write the snapshot to *p* of size() bytes.
+  void write(char *p) const {
+    std::memset(p, 0, size());
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, _snapshot_magic, sizeof(header.magic));
+    header.version = _snapshot_version;
+    header.byte_order = _snapshot_byte_order;
+    header.char_size = sizeof(char_t);
+    header.strings = lengths_.size();
+    header.string_units = data_.size();
+    header.nodes = nodes_.size();
+    header.attributes = attributes_.size();
+    std::memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    std::memcpy(p, lengths_.data(), lengths_.size() * sizeof(uint32_t));
+    p += snapshot_align(lengths_.size() * sizeof(uint32_t));
+    std::memcpy(p, data_.data(), data_.size() * sizeof(char_t));
+    p += snapshot_align(data_.size() * sizeof(char_t));
+    std::memcpy(p, nodes_.data(), nodes_.size() * sizeof(SnapshotNode));
+    p += snapshot_align(nodes_.size() * sizeof(SnapshotNode));
+    std::memcpy(p, attributes_.data(), attributes_.size() * sizeof(SnapshotAttribute));
+  }
+
+private:
+  std::unordered_map<std::basic_string_view<char_t>, uint32_t> indices_;
+  std::vector<uint32_t> lengths_;
+  std::basic_string<char_t> data_;
+  std::vector<SnapshotNode> nodes_;
+  std::vector<SnapshotAttribute> attributes_;
+
+  uint32_t add_string(const char_t *s) {
+    if (!*s) {
+      return 0;
+    }
+    const std::basic_string_view<char_t> key(s);
+    const auto it = indices_.find(key);
+    if (it != indices_.end()) {
+      return it->second;
+    }
+    const auto index = static_cast<uint32_t>(lengths_.size());
+    lengths_.push_back(static_cast<uint32_t>(key.size()));
+    data_.append(key);
+    data_.push_back(0);
+    indices_.emplace(key, index);
+    return index;
+  }
+
+  void add_node(const xml_node &node) {
+    SnapshotNode record{static_cast<uint32_t>(node.type()), add_string(node.name()), add_string(node.value()), 0, 0};
+    for (auto attr = node.first_attribute(); attr; attr = attr.next_attribute()) {
+      attributes_.push_back({add_string(attr.name()), add_string(attr.value())});
+      ++record.attributes;
+    }
+    for (auto child = node.first_child(); child; child = child.next_sibling()) {
+      ++record.children;
+    }
+    nodes_.push_back(record);
+  }
+};
+
+class SnapshotLoader {
+public:
+  SnapshotLoader(const char *data, size_t size) : data_(data), size_(size) {}
+
+  void load(xml_document &doc) {
+    doc.reset();
+    if (!load_tree(doc)) {
+      doc.reset();
+      throw py::value_error("invalid snapshot");
+    }
+  }
+
+private:
+  const char *data_;
+  size_t size_;
+  std::vector<const char_t *> strings_;
+  std::vector<uint32_t> lengths_;
+  xml_document scratch_;
+
+  template <typename T> T read(size_t offset) const {
+    T value;
+    std::memcpy(&value, data_ + offset, sizeof(T));
+    return value;
+  }
+
+  // Append the element with the value embedded by parse_embed_pcdata. The value of an element can not be set with
+  // the API, so the element is parsed from the escaped value and copied.
+  xml_node append_embedded_element(xml_node &parent, uint32_t value) {
+    std::basic_string<char_t> source = PUGIXML_TEXT("<a>");
+    for (auto p = strings_[value], end = p + lengths_[value]; p != end; ++p) {
+      switch (*p) {
+      case '&':
+        source += PUGIXML_TEXT("&amp;");
+        break;
+      case '<':
+        source += PUGIXML_TEXT("&lt;");
+        break;
+      default:
+        source += *p;
+        break;
+      }
+    }
+    source += PUGIXML_TEXT("</a>");
+    if (!scratch_.load_string(source.c_str(), parse_escapes | parse_ws_pcdata | parse_embed_pcdata)) {
+      return xml_node();
+    }
+    const auto element = scratch_.first_child();
+    const std::basic_string_view<char_t> expected(strings_[value], lengths_[value]);
+    if (element.first_child() || element.value() != expected) {
+      return xml_node();
+    }
+    return parent.append_copy(element);
+  }
+
+  bool load_tree(xml_document &doc) {
+    if (size_ < sizeof(SnapshotHeader)) {
+      return false;
+    }
+    const auto header = read<SnapshotHeader>(0);
+    if (std::memcmp(header.magic, _snapshot_magic, sizeof(header.magic)) != 0 ||
+        header.version != _snapshot_version || header.byte_order != _snapshot_byte_order ||
+        header.char_size != sizeof(char_t) || header.strings == 0 || header.nodes == 0) {
+      return false;
+    }
+    const auto limit = size_ / sizeof(uint32_t);
+    if (header.strings > limit || header.string_units > limit || header.nodes > limit || header.attributes > limit) {
+      return false;
+    }
+
+    const auto lengths_offset = sizeof(SnapshotHeader);
+    const auto data_offset = lengths_offset + snapshot_align(header.strings * sizeof(uint32_t));
+    const auto nodes_offset = data_offset + snapshot_align(header.string_units * sizeof(char_t));
+    const auto attributes_offset = nodes_offset + snapshot_align(header.nodes * sizeof(SnapshotNode));
+    const auto end = attributes_offset + snapshot_align(header.attributes * sizeof(SnapshotAttribute));
+    if (end > size_) {
+      return false;
+    }
+
+    const auto data = reinterpret_cast<const char_t *>(data_ + data_offset);
+    strings_.reserve(header.strings);
+    lengths_.reserve(header.strings);
+    size_t position = 0;
+    for (size_t n = 0; n < header.strings; ++n) {
+      const auto length = read<uint32_t>(lengths_offset + n * sizeof(uint32_t));
+      if (length >= header.string_units - position || data[position + length] != 0) {
+        return false;
+      }
+      strings_.push_back(data + position);
+      lengths_.push_back(length);
+      position += length + 1;
+    }
+
+    auto record = read<SnapshotNode>(nodes_offset);
+    if (record.type != static_cast<uint32_t>(node_document) || record.attributes != 0) {
+      return false;
+    }
+    std::vector<std::pair<xml_node, uint32_t>> stack{{doc, record.children}};
+    size_t attribute_index = 0;
+    for (size_t n = 1; n < header.nodes; ++n) {
+      while (!stack.empty() && stack.back().second == 0) {
+        stack.pop_back();
+      }
+      if (stack.empty()) {
+        return false;
+      }
+      auto &parent = stack.back();
+      --parent.second;
+
+      record = read<SnapshotNode>(nodes_offset + n * sizeof(SnapshotNode));
+      if (record.type <= static_cast<uint32_t>(node_document) || record.type > static_cast<uint32_t>(node_doctype) ||
+          record.name >= header.strings ||
+          record.value >= header.strings || record.attributes > header.attributes - attribute_index) {
+        return false;
+      }
+      // element nodes can have value if parse_embed_pcdata was used
+      auto node = record.type == static_cast<uint32_t>(node_element) && record.value
+                      ? append_embedded_element(parent.first, record.value)
+                      : parent.first.append_child(static_cast<xml_node_type>(record.type));
+      if (!node || (record.name && !node.set_name(strings_[record.name], lengths_[record.name]))) {
+        return false;
+      }
+      if (record.value && record.type != static_cast<uint32_t>(node_element) &&
+          !node.set_value(strings_[record.value], lengths_[record.value])) {
+        return false;
+      }
+
+      for (uint32_t i = 0; i < record.attributes; ++i, ++attribute_index) {
+        const auto attr_record =
+            read<SnapshotAttribute>(attributes_offset + attribute_index * sizeof(SnapshotAttribute));
+        if (attr_record.name >= header.strings || attr_record.value >= header.strings) {
+          return false;
+        }
+        auto attr = node.append_attribute(strings_[attr_record.name]);
+        if (!attr || (attr_record.value && !attr.set_value(strings_[attr_record.value], lengths_[attr_record.value]))) {
+          return false;
+        }
+      }
+
+      if (record.children) {
+        if (record.type != static_cast<uint32_t>(node_element)) {
+          return false;
+        }
+        stack.emplace_back(node, record.children);
+      }
+    }
+
+    for (const auto &item : stack) {
+      if (item.second) {
+        return false;
+      }
+    }
+    return attribute_index == header.attributes;
+  }
+};
+
+static py::bytes save_snapshot(const xml_document &doc) {
+  SnapshotBuilder builder;
+  {
+    py::gil_scoped_release release;
+    builder.add_tree(doc);
+  }
+  const auto size = builder.size();
+  auto result = py::reinterpret_steal<py::bytes>(PyBytes_FromStringAndSize(nullptr, static_cast<Py_ssize_t>(size)));
+  if (!result) {
+    throw py::error_already_set();
+  }
+  builder.write(PyBytes_AS_STRING(result.ptr()));
+  return result;
+}
+
+// Return the binary DOM snapshot of *doc* as a string; the GIL is not required.
+static std::string save_snapshot_data(const xml_document &doc) {
+  SnapshotBuilder builder;
+  builder.add_tree(doc);
+  std::string result(builder.size(), '\0');
+  builder.write(result.data());
+  return result;
+}
+
+static void load_snapshot(xml_document &doc, const char *data, size_t size) { SnapshotLoader(data, size).load(doc); }
+
+// Compression of the files of XMLDocument.load_file() and save_file(); the codecs are available if the module is built
+// with PUGIXML_ZLIB (gzip) and PUGIXML_ZSTD (zstd).
+enum class Compression { none, gzip, zstd };
+
+// Return the compression of the file from the magic number.
+static Compression detect_compression(const fs::path &path) {
+  unsigned char magic[4] = {};
+  std::ifstream file(path, std::ios::binary);
+  file.read(reinterpret_cast<char *>(magic), sizeof(magic));
+  const auto size = file.gcount();
+  if (size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+    return Compression::gzip;
+  }
+  if (size >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+    return Compression::zstd;
+  }
+  return Compression::none;
+}
+
+// Return the compression of the file from the suffix.
+static Compression compression_from_suffix(const fs::path &path) {
+  const auto suffix = path.extension();
+  if (suffix == ".gz") {
+    return Compression::gzip;
+  }
+  if (suffix == ".zst") {
+    return Compression::zstd;
+  }
+  return Compression::none;
+}
+
+// Return the compression named *name* ("gzip", "zstd" or "none"); if *name* is None, the compression is detected from
+// the contents of the file to load or the suffix of the file to save (the GIL must be held).
+static Compression get_compression(const std::optional<std::string> &name, const fs::path &path, bool load) {
+  Compression compression;
+  if (!name) {
+    compression = load ? detect_compression(path) : compression_from_suffix(path);
+  } else if (*name == "none") {
+    compression = Compression::none;
+  } else if (*name == "gzip") {
+    compression = Compression::gzip;
+  } else if (*name == "zstd") {
+    compression = Compression::zstd;
+  } else {
+    throw py::value_error("unsupported compression: " + *name);
+  }
+#ifndef PUGIXML_ZLIB
+  if (compression == Compression::gzip) {
+    throw py::value_error("gzip compression is not supported by this build");
+  }
+#endif // PUGIXML_ZLIB
+#ifndef PUGIXML_ZSTD
+  if (compression == Compression::zstd) {
+    throw py::value_error("zstd compression is not supported by this build");
+  }
+#endif // PUGIXML_ZSTD
+  return compression;
+}
+
+// On-disk cache of XMLDocument.load_file(): CacheHeader followed by the binary DOM snapshot.
+struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t options;
+  uint32_t encoding;
+  uint32_t source_encoding;
+  uint64_t source_size;
+  int64_t source_mtime;
+};
+
+static constexpr char _cache_magic[8] = {'P', 'U', 'G', 'I', 'C', 'A', 'C', 'H'};
+static constexpr uint32_t _cache_version = 1;
+
+// Return the cache file path for the source document (FNV-1a hash of the absolute path).
+static fs::path cache_file_path(const fs::path &cache_dir, const fs::path &path) {
+  std::error_code ec;
+  auto source = fs::absolute(path, ec);
+  if (ec) {
+    source = path;
+  }
+  const auto &native = source.lexically_normal().native();
+  const auto bytes = reinterpret_cast<const unsigned char *>(native.data());
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t n = 0; n < native.size() * sizeof(fs::path::value_type); ++n) {
+    hash = (hash ^ bytes[n]) * 1099511628211ULL;
+  }
+  std::stringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << hash << ".pugisnap";
+  return cache_dir / ss.str();
+}
+
+static bool load_cached_document(xml_document &doc, const fs::path &cache, const CacheHeader &expected,
+                                 xml_parse_result &result) {
+  std::ifstream file(cache, std::ios_base::in | std::ios_base::binary);
+  if (!file) {
+    return false;
+  }
+  std::error_code ec;
+  const auto size = fs::file_size(cache, ec);
+  if (ec || size < sizeof(CacheHeader)) {
+    return false;
+  }
+  std::string data(size, '\0');
+  if (!file.read(data.data(), static_cast<std::streamsize>(size))) {
+    return false;
+  }
+
+  CacheHeader header;
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version ||
+      header.options != expected.options || header.encoding != expected.encoding ||
+      header.source_size != expected.source_size || header.source_mtime != expected.source_mtime) {
+    return false;
+  }
+  try {
+    load_snapshot(doc, data.data() + sizeof(header), data.size() - sizeof(header));
+  } catch (const py::value_error &) {
+    return false;
+  }
+  result.status = status_ok;
+  result.offset = 0;
+  result.encoding = static_cast<xml_encoding>(header.source_encoding);
+  return true;
+}
+
+static void save_cached_document(const xml_document &doc, const fs::path &cache, const CacheHeader &header) {
+  const auto snapshot = save_snapshot_data(doc);
+  std::error_code ec;
+  fs::create_directories(cache.parent_path(), ec);
+
+  // write to a temporary file, then rename it to replace the cache file atomically
+  auto temp = cache;
+  temp += "." + std::to_string(std::random_device()()) + ".tmp";
+  {
+    std::ofstream file(temp, std::ios_base::out | std::ios_base::binary);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(snapshot.data(), static_cast<std::streamsize>(snapshot.size()));
+    file.close();
+    if (!file) {
+      fs::remove(temp, ec);
+      return;
+    }
+  }
+  fs::rename(temp, cache, ec);
+  if (ec) {
+    fs::remove(temp, ec);
+  }
+}
+
+// Load the document from the cache, or by *load* (the loader of the file with *options* and *encoding*); the GIL is
+// not required.
+template <typename Load>
+static xml_parse_result load_file_cached(xml_document &doc, const fs::path &path, unsigned int options,
+                                         xml_encoding encoding, const fs::path &cache_dir, Load &&load) {
+  std::error_code ec;
+  const auto size = fs::file_size(path, ec);
+  const auto mtime = ec ? fs::file_time_type() : fs::last_write_time(path, ec);
+  if (ec) {
+    return load();
+  }
+
+  CacheHeader header{};
+  std::memcpy(header.magic, _cache_magic, sizeof(header.magic));
+  header.version = _cache_version;
+  header.options = options;
+  header.encoding = static_cast<uint32_t>(encoding);
+  header.source_size = size;
+  header.source_mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+
+  const auto cache = cache_file_path(cache_dir, path);
+  xml_parse_result result;
+  if (load_cached_document(doc, cache, header, result)) {
+    return result;
+  }
+
+  result = load();
+  if (result) {
+    header.source_encoding = static_cast<uint32_t>(result.encoding);
+    save_cached_document(doc, cache, header);
+  }
+  return result;
+}
+
+// Bounded cache of the interned Python strings for the node and attribute names (the GIL must be held).
+// When the cache is full, the oldest name is evicted.
+class NameCache {
+public:
+  NameCache() { keys_.reserve(max_size_); }
+
+  py::str get(const char_t *name) {
+    const std::basic_string_view<char_t> key(name);
+    if (key.size() > max_length_) {
+      return to_str(name, key.size());
+    }
+    const auto it = names_.find(key);
+    if (it != names_.end()) {
+      return it->second;
+    }
+    auto value = to_str(name, key.size()).release().ptr();
+    PyUnicode_InternInPlace(&value);
+    auto result = py::reinterpret_steal<py::str>(value);
+    // The map refers to the names owned by keys_, which is never reallocated.
+    if (keys_.size() < max_size_) {
+      keys_.emplace_back(key);
+      names_.emplace(keys_.back(), result);
+      return result;
+    }
+    auto &oldest = keys_[next_];
+    names_.erase(names_.find(oldest));
+    oldest.assign(key);
+    names_.emplace(oldest, result);
+    next_ = (next_ + 1) % max_size_;
+    return result;
+  }
+
+private:
+  static constexpr size_t max_length_ = 256;
+  static constexpr size_t max_size_ = 4096;
+  std::unordered_map<std::basic_string_view<char_t>, py::str> names_;
+  std::vector<string_t> keys_;
+  size_t next_ = 0;
+};
+
+// The cache is never destroyed, since the strings must not be released after the interpreter is finalized.
+static auto *const _name_cache = new NameCache();
+
+// Set the Python object to the attribute value or the text with the matching overload of set_value()/set().
+template <typename Setter> static bool set_object_value(const py::handle &value, int precision, Setter &&set) {
+  const auto obj = value.ptr();
+  if (PyBool_Check(obj)) {
+    return set(obj == Py_True);
+  }
+  if (PyLong_Check(obj)) {
+    int overflow = 0;
+    const auto number = PyLong_AsLongLongAndOverflow(obj, &overflow);
+    if (overflow == 0) {
+      if (number == -1 && PyErr_Occurred()) {
+        throw py::error_already_set();
+      }
+      return set(number);
+    }
+    const auto unsigned_number = PyLong_AsUnsignedLongLong(obj);
+    if (unsigned_number == static_cast<unsigned long long>(-1) && PyErr_Occurred()) {
+      throw py::error_already_set();
+    }
+    return set(unsigned_number);
+  }
+  if (PyFloat_Check(obj)) {
+    return set(PyFloat_AS_DOUBLE(obj), precision);
+  }
+  if (PyUnicode_Check(obj)) {
+    const auto text = value.cast<string_t>();
+    return set(text.c_str(), text.size());
+  }
+  throw py::type_error("unsupported value type: " + std::string(Py_TYPE(obj)->tp_name));
+}
+
+// Append the attributes from the mapping to the node.
+static void append_object_attributes(xml_node &node, const py::handle &attrs, int precision) {
+  const auto append = [&](const py::handle &name, const py::handle &value) {
+    if (!PyUnicode_Check(name.ptr())) {
+      throw py::type_error("attribute name must be str, not " + std::string(Py_TYPE(name.ptr())->tp_name));
+    }
+    auto attr = node.append_attribute(name.cast<string_t>().c_str());
+    set_object_value(value, precision, [&](auto... args) { return attr.set_value(args...); });
+  };
+  if (PyDict_Check(attrs.ptr())) {
+    for (const auto &item : py::reinterpret_borrow<py::dict>(attrs)) {
+      append(item.first, item.second);
+    }
+  } else {
+    for (const auto &item : attrs.attr("items")()) {
+      const auto pair = item.cast<py::tuple>();
+      append(pair[0], pair[1]);
+    }
+  }
+}
+
+// (pugixml-python only) Parse option to search the text with memchr() instead of the pugixml scanner.
+static constexpr unsigned int parse_fast_scan = 0x100000;
+
+#ifndef PUGIXML_WCHAR_MODE
+// Parser for PARSE_MINIMAL | PARSE_FAST_SCAN.
+//
+// The text and the attribute values are searched with memchr(), which the C runtime vectorizes (SSE2/AVX2/AVX-512
+// selected at run time, with a scalar fallback), and copied into the tree at once. Only elements, attributes, text
+// and a leading UTF-8 XML declaration are supported; the documents with other markup, or that are not well-formed,
+// are rejected so that they are parsed by pugixml. The resulting tree is the same as with PARSE_MINIMAL.
+class FastScanner {
+public:
+  FastScanner(const char *data, size_t size) : p_(data), end_(data + size) {}
+
+  bool parse(xml_document &doc) {
+    if (std::memchr(p_, 0, end_ - p_)) {
+      return false; // UTF-16/32 or binary data
+    }
+    if (end_ - p_ >= 3 && std::memcmp(p_, "\xEF\xBB\xBF", 3) == 0) {
+      p_ += 3;
+    }
+    if (!skip_declaration()) {
+      return false;
+    }
+    std::vector<xml_node> stack{doc};
+    while (p_ < end_) {
+      const auto lt = static_cast<const char *>(std::memchr(p_, '<', end_ - p_));
+      const auto text_end = lt ? lt : end_;
+      if (stack.size() > 1) {
+        add_text(stack.back(), p_, text_end); // The text outside the document element is discarded.
+      }
+      if (!lt) {
+        break;
+      }
+      p_ = lt + 1;
+      if (p_ < end_ && *p_ == '/') {
+        ++p_;
+        if (stack.size() == 1 || !parse_end_tag(stack.back())) {
+          return false;
+        }
+        stack.pop_back();
+      } else {
+        xml_node node;
+        bool closed = false;
+        if (!parse_start_tag(stack.back(), node, closed)) {
+          return false;
+        }
+        if (!closed) {
+          stack.push_back(node);
+        }
+      }
+    }
+    return stack.size() == 1 && doc.document_element();
+  }
+
+private:
+  static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+  static bool is_start_symbol(char c) {
+    const auto u = static_cast<unsigned char>(c);
+    return u >= 0x80 || (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || u == '_' || u == ':';
+  }
+
+  static bool is_symbol(char c) {
+    return is_start_symbol(c) || (c >= '0' && c <= '9') || c == '-' || c == '.';
+  }
+
+  void skip_space() {
+    while (p_ < end_ && is_space(*p_)) {
+      ++p_;
+    }
+  }
+
+  bool parse_name(const char *&name, size_t &size) {
+    if (p_ == end_ || !is_start_symbol(*p_)) {
+      return false;
+    }
+    name = p_;
+    while (p_ < end_ && is_symbol(*p_)) {
+      ++p_;
+    }
+    size = p_ - name;
+    return true;
+  }
+
+  // Skip "<?xml ...?>" at the beginning, which PARSE_MINIMAL does not add to the tree.
+  bool skip_declaration() {
+    if (end_ - p_ < 6 || std::memcmp(p_, "<?xml", 5) != 0 || !(is_space(p_[5]) || p_[5] == '?')) {
+      return true;
+    }
+    const auto begin = p_ + 5;
+    const std::string_view rest(begin, end_ - begin);
+    const auto close = rest.find("?>");
+    if (close == std::string_view::npos) {
+      return false;
+    }
+    const auto declaration = rest.substr(0, close);
+    const auto encoding = declaration.find("encoding");
+    if (encoding != std::string_view::npos) {
+      const auto value = declaration.substr(encoding + 8);
+      const auto quote = value.find_first_of("'\"");
+      if (quote == std::string_view::npos) {
+        return false;
+      }
+      const auto name = value.substr(quote + 1, 5);
+      if (name.size() != 5 || (name[0] | 0x20) != 'u' || (name[1] | 0x20) != 't' || (name[2] | 0x20) != 'f' ||
+          name[3] != '-' || name[4] != '8') {
+        return false; // The document is converted from another encoding by pugixml.
+      }
+    }
+    p_ = begin + close + 2;
+    return true;
+  }
+
+  static void add_text(xml_node &parent, const char *begin, const char *end) {
+    for (auto p = begin; p < end; ++p) {
+      if (!is_space(*p)) {
+        parent.append_child(node_pcdata).set_value(begin, end - begin);
+        return;
+      }
+    }
+  }
+
+  bool parse_start_tag(xml_node &parent, xml_node &node, bool &closed) {
+    const char *name;
+    size_t size;
+    if (!parse_name(name, size)) {
+      return false; // "<!", "<?", etc.
+    }
+    node = parent.append_child(node_element);
+    node.set_name(name, size);
+    while (true) {
+      const auto space = p_ < end_ && is_space(*p_);
+      skip_space();
+      if (p_ == end_) {
+        return false;
+      }
+      if (*p_ == '>') {
+        ++p_;
+        return true;
+      }
+      if (*p_ == '/') {
+        if (end_ - p_ < 2 || p_[1] != '>') {
+          return false;
+        }
+        p_ += 2;
+        closed = true;
+        return true;
+      }
+      if (!space || !parse_attribute(node)) {
+        return false;
+      }
+    }
+  }
+
+  bool parse_attribute(xml_node &node) {
+    const char *name;
+    size_t size;
+    if (!parse_name(name, size)) {
+      return false;
+    }
+    skip_space();
+    if (p_ == end_ || *p_ != '=') {
+      return false;
+    }
+    ++p_;
+    skip_space();
+    if (p_ == end_ || (*p_ != '"' && *p_ != '\'')) {
+      return false;
+    }
+    const auto quote = *p_++;
+    const auto value_end = static_cast<const char *>(std::memchr(p_, quote, end_ - p_));
+    if (!value_end) {
+      return false;
+    }
+    auto attr = node.append_attribute(PUGIXML_TEXT(""));
+    attr.set_name(name, size);
+    attr.set_value(p_, value_end - p_);
+    p_ = value_end + 1;
+    return p_ < end_ && (is_space(*p_) || *p_ == '/' || *p_ == '>');
+  }
+
+  bool parse_end_tag(const xml_node &node) {
+    const auto name = node.name();
+    const auto size = std::strlen(name);
+    if (static_cast<size_t>(end_ - p_) < size || std::memcmp(p_, name, size) != 0) {
+      return false;
+    }
+    p_ += size;
+    if (p_ < end_ && is_symbol(*p_)) {
+      return false;
+    }
+    skip_space();
+    if (p_ == end_ || *p_ != '>') {
+      return false;
+    }
+    ++p_;
+    return true;
+  }
+
+  const char *p_;
+  const char *end_;
+};
+#endif // PUGIXML_WCHAR_MODE
+
+// Load the document with FastScanner if PARSE_FAST_SCAN is applicable; PARSE_FAST_SCAN is removed from *options*.
+static std::optional<xml_parse_result> load_fast_scan(xml_document &doc, const char *contents, size_t size,
+                                                      unsigned int &options, xml_encoding encoding) {
+  if (!(options & parse_fast_scan)) {
+    return std::nullopt;
+  }
+  options &= ~parse_fast_scan;
+#ifdef PUGIXML_WCHAR_MODE
+  return std::nullopt;
+#else
+  if (options != parse_minimal || (encoding != encoding_auto && encoding != encoding_utf8)) {
+    return std::nullopt;
+  }
+  doc.reset();
+  if (!FastScanner(contents, size).parse(doc)) {
+    doc.reset();
+    return std::nullopt;
+  }
+  xml_parse_result result;
+  result.status = status_ok;
+  result.offset = 0;
+  result.encoding = encoding_utf8;
+  return result;
+#endif // PUGIXML_WCHAR_MODE
+}
+
+// Growable buffer allocated by the pugixml allocator, so that the document takes it over as the parse buffer without
+// copying.
+class ParseBuffer {
+public:
+  ParseBuffer() = default;
+  ParseBuffer(const ParseBuffer &) = delete;
+  ParseBuffer &operator=(const ParseBuffer &) = delete;
+  ~ParseBuffer() { get_memory_deallocation_function()(data_); }
+
+  // Return the space for at least *size* more bytes, or nullptr if out of memory.
+  char *reserve(size_t size) {
+    if (size > capacity_ - size_) {
+      const auto capacity = std::max({capacity_ * 2, size_ + size, static_cast<size_t>(4096)});
+      auto *data = static_cast<char *>(get_memory_allocation_function()(capacity));
+      if (!data) {
+        return nullptr;
+      }
+      if (size_ > 0) {
+        std::memcpy(data, data_, size_);
+      }
+      get_memory_deallocation_function()(data_);
+      data_ = data;
+      capacity_ = capacity;
+    }
+    return data_ + size_;
+  }
+
+  // Add *size* bytes written to the space returned by reserve().
+  void commit(size_t size) { size_ += size; }
+
+  size_t available() const { return capacity_ - size_; }
+
+  size_t size() const { return size_; }
+
+  const char *data() const { return data_; }
+
+  // Load the document from the buffer, which is passed to the document.
+  xml_parse_result load(xml_document &doc, unsigned int options, xml_encoding encoding) {
+    auto *contents = std::exchange(data_, nullptr);
+    const auto size = std::exchange(size_, 0);
+    capacity_ = 0;
+    if (!contents) {
+      return doc.load_buffer("", 0, options & ~parse_fast_scan, encoding);
+    }
+    if (const auto result = load_fast_scan(doc, contents, size, options, encoding)) {
+      get_memory_deallocation_function()(contents);
+      return *result;
+    }
+    return doc.load_buffer_inplace_own(contents, size, options, encoding);
+  }
+
+private:
+  char *data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+};
+
+static constexpr size_t _compression_chunk_size = 64 * 1024;
+
+// The uncompressed size stored in a compressed file is only a hint, since the file may be broken or crafted: the
+// initial buffer is at most this many times the compressed size, and it grows beyond that as the data is decompressed.
+static constexpr uint64_t _max_compression_ratio = 64;
+
+// Reserve the buffer for the uncompressed size *hint* of the compressed file of *compressed_size* bytes.
+static void reserve_size_hint(ParseBuffer &buffer, uint64_t hint, uint64_t compressed_size) {
+  const auto limit = std::max<uint64_t>(compressed_size * _max_compression_ratio, _compression_chunk_size);
+  const auto size = std::min({hint, limit, static_cast<uint64_t>(std::numeric_limits<size_t>::max() - 1)});
+  buffer.reserve(static_cast<size_t>(size) + 1);
+}
+
+#ifdef PUGIXML_ZLIB
+// Decompress the gzip file (one or more members) into *buffer*.
+static xml_parse_status read_gzip(std::ifstream &file, ParseBuffer &buffer) {
+  // The last 4 bytes of the file are the size of the uncompressed data modulo 2^32 (+1 to end the stream without
+  // growing the buffer).
+  file.seekg(-4, std::ios::end);
+  const auto compressed_size = static_cast<uint64_t>(file.tellg()) + 4;
+  unsigned char trailer[4] = {};
+  if (file.read(reinterpret_cast<char *>(trailer), sizeof(trailer))) {
+    const auto size = static_cast<uint32_t>(trailer[0]) | static_cast<uint32_t>(trailer[1]) << 8 |
+                      static_cast<uint32_t>(trailer[2]) << 16 | static_cast<uint32_t>(trailer[3]) << 24;
+    reserve_size_hint(buffer, size, compressed_size);
+  }
+  file.clear();
+  file.seekg(0);
+
+  z_stream stream{};
+  if (inflateInit2(&stream, 15 + 16) != Z_OK) {
+    return status_out_of_memory;
+  }
+  std::vector<char> input(_compression_chunk_size);
+  auto status = status_io_error;
+  for (;;) {
+    if (stream.avail_in == 0) {
+      file.read(input.data(), static_cast<std::streamsize>(input.size()));
+      if (file.gcount() <= 0) {
+        break; // truncated
+      }
+      stream.next_in = reinterpret_cast<Bytef *>(input.data());
+      stream.avail_in = static_cast<uInt>(file.gcount());
+    }
+    auto *output = buffer.reserve(1);
+    if (!output) {
+      status = status_out_of_memory;
+      break;
+    }
+    const auto available = static_cast<uInt>(std::min<size_t>(buffer.available(), std::numeric_limits<uInt>::max()));
+    stream.next_out = reinterpret_cast<Bytef *>(output);
+    stream.avail_out = available;
+    const auto result = inflate(&stream, Z_NO_FLUSH);
+    buffer.commit(available - stream.avail_out);
+    if (result == Z_STREAM_END) {
+      if (stream.avail_in == 0 && file.peek() == std::char_traits<char>::eof()) {
+        status = status_ok;
+        break;
+      }
+      if (inflateReset(&stream) != Z_OK) {
+        break;
+      }
+    } else if (result != Z_OK && result != Z_BUF_ERROR) {
+      status = result == Z_MEM_ERROR ? status_out_of_memory : status_io_error;
+      break;
+    }
+  }
+  inflateEnd(&stream);
+  return status;
+}
+#endif // PUGIXML_ZLIB
+
+#ifdef PUGIXML_ZSTD
+// Decompress the zstd file (one or more frames) into *buffer*.
+static xml_parse_status read_zstd(std::ifstream &file, ParseBuffer &buffer) {
+  std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+  if (!context) {
+    return status_out_of_memory;
+  }
+  file.seekg(0, std::ios::end);
+  const auto compressed_size = static_cast<uint64_t>(file.tellg());
+  file.seekg(0);
+  std::vector<char> input(ZSTD_DStreamInSize());
+  size_t result = 0;
+  bool first = true;
+  while (file.read(input.data(), static_cast<std::streamsize>(input.size())) || file.gcount() > 0) {
+    ZSTD_inBuffer in{input.data(), static_cast<size_t>(file.gcount()), 0};
+    if (first) {
+      first = false;
+      const auto size = ZSTD_getFrameContentSize(in.src, in.size);
+      if (size != ZSTD_CONTENTSIZE_UNKNOWN && size != ZSTD_CONTENTSIZE_ERROR) {
+        reserve_size_hint(buffer, size, compressed_size);
+      }
+    }
+    while (in.pos < in.size) {
+      auto *output = buffer.reserve(1);
+      if (!output) {
+        return status_out_of_memory;
+      }
+      ZSTD_outBuffer out{output, buffer.available(), 0};
+      result = ZSTD_decompressStream(context.get(), &out, &in);
+      if (ZSTD_isError(result)) {
+        return status_io_error;
+      }
+      buffer.commit(out.pos);
+    }
+  }
+  // The result is not 0 if the last frame is truncated.
+  return result == 0 && !first ? status_ok : status_io_error;
+}
+#endif // PUGIXML_ZSTD
+
+// Read the (compressed) file into *buffer*; the GIL is not required.
+static xml_parse_status read_document_file(const fs::path &path, Compression compression, ParseBuffer &buffer) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return status_file_not_found;
+  }
+  if (compression == Compression::none) {
+    std::error_code ec;
+    const auto size = fs::file_size(path, ec);
+    if (ec) {
+      return status_io_error;
+    }
+    if (size == 0) {
+      return status_ok;
+    }
+    auto *data = buffer.reserve(static_cast<size_t>(size));
+    if (!data) {
+      return status_out_of_memory;
+    }
+    if (!file.read(data, static_cast<std::streamsize>(size))) {
+      return status_io_error;
+    }
+    buffer.commit(static_cast<size_t>(size));
+    return status_ok;
+  }
+#ifdef PUGIXML_ZLIB
+  if (compression == Compression::gzip) {
+    return read_gzip(file, buffer);
+  }
+#endif // PUGIXML_ZLIB
+#ifdef PUGIXML_ZSTD
+  if (compression == Compression::zstd) {
+    return read_zstd(file, buffer);
+  }
+#endif // PUGIXML_ZSTD
+  return status_io_error;
+}
+
+// Load the document from the compressed file; the GIL is not required.
+static xml_parse_result load_compressed_file(xml_document &doc, const fs::path &path, unsigned int options,
+                                             xml_encoding encoding, Compression compression) {
+  ParseBuffer buffer;
+  xml_parse_result result;
+  result.offset = 0;
+  result.status = read_document_file(path, compression, buffer);
+  if (result.status != status_ok) {
+    doc.reset();
+    return result;
+  }
+  return buffer.load(doc, options, encoding);
+}
+
+// xml_writer that compresses the output to a file.
+class CompressedFileWriter : public xml_writer {
+public:
+  explicit CompressedFileWriter(std::ofstream &file) : file_(file), output_(_compression_chunk_size) {}
+
+  // Write the rest of the compressed data; return false if failed.
+  virtual bool finish() = 0;
+
+protected:
+  std::ofstream &file_;
+  std::vector<char> output_;
+  bool ok_ = true;
+};
+
+#ifdef PUGIXML_ZLIB
+class GzipFileWriter : public CompressedFileWriter {
+public:
+  explicit GzipFileWriter(std::ofstream &file) : CompressedFileWriter(file) {
+    initialized_ = deflateInit2(&stream_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+    ok_ = initialized_;
+  }
+  ~GzipFileWriter() override {
+    if (initialized_) {
+      deflateEnd(&stream_);
+    }
+  }
+
+  void write(const void *data, size_t size) override { compress(data, size, Z_NO_FLUSH); }
+
+  bool finish() override {
+    compress(nullptr, 0, Z_FINISH);
+    return ok_ && file_;
+  }
+
+private:
+  void compress(const void *data, size_t size, int flush) {
+    auto *input = static_cast<const Bytef *>(data);
+    while (ok_) {
+      const auto count = std::min<size_t>(size, std::numeric_limits<uInt>::max());
+      stream_.next_in = const_cast<Bytef *>(input);
+      stream_.avail_in = static_cast<uInt>(count);
+      input += count;
+      size -= count;
+      do {
+        stream_.next_out = reinterpret_cast<Bytef *>(output_.data());
+        stream_.avail_out = static_cast<uInt>(output_.size());
+        if (deflate(&stream_, size > 0 ? Z_NO_FLUSH : flush) == Z_STREAM_ERROR) {
+          ok_ = false;
+          return;
+        }
+        file_.write(output_.data(), static_cast<std::streamsize>(output_.size() - stream_.avail_out));
+      } while (stream_.avail_out == 0);
+      if (size == 0) {
+        return;
+      }
+    }
+  }
+
+  z_stream stream_{};
+  bool initialized_ = false;
+};
+#endif // PUGIXML_ZLIB
+
+#ifdef PUGIXML_ZSTD
+class ZstdFileWriter : public CompressedFileWriter {
+public:
+  explicit ZstdFileWriter(std::ofstream &file)
+      : CompressedFileWriter(file), context_(ZSTD_createCCtx(), ZSTD_freeCCtx) {
+    ok_ = context_ != nullptr;
+  }
+
+  void write(const void *data, size_t size) override { compress(data, size, ZSTD_e_continue); }
+
+  bool finish() override {
+    compress(nullptr, 0, ZSTD_e_end);
+    return ok_ && file_;
+  }
+
+private:
+  void compress(const void *data, size_t size, ZSTD_EndDirective mode) {
+    ZSTD_inBuffer input{data, size, 0};
+    bool finished = !ok_;
+    while (!finished) {
+      ZSTD_outBuffer output{output_.data(), output_.size(), 0};
+      const auto remaining = ZSTD_compressStream2(context_.get(), &output, &input, mode);
+      if (ZSTD_isError(remaining)) {
+        ok_ = false;
+        return;
+      }
+      file_.write(output_.data(), static_cast<std::streamsize>(output.pos));
+      finished = mode == ZSTD_e_end ? remaining == 0 : input.pos == input.size;
+    }
+  }
+
+  std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context_;
+};
+#endif // PUGIXML_ZSTD
+
+// Save the document to the compressed file; the GIL is not required.
+static bool save_compressed_file(const xml_document &doc, const fs::path &path, const char_t *indent,
+                                 unsigned int flags, xml_encoding encoding, Compression compression) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file) {
+    return false;
+  }
+  std::unique_ptr<CompressedFileWriter> writer;
+#ifdef PUGIXML_ZLIB
+  if (compression == Compression::gzip) {
+    writer = std::make_unique<GzipFileWriter>(file);
+  }
+#endif // PUGIXML_ZLIB
+#ifdef PUGIXML_ZSTD
+  if (compression == Compression::zstd) {
+    writer = std::make_unique<ZstdFileWriter>(file);
+  }
+#endif // PUGIXML_ZSTD
+  if (!writer) {
+    return false;
+  }
+  doc.save(*writer, indent, flags, encoding);
+  const auto ok = writer->finish();
+  file.close();
+  return ok && !file.fail();
+}
+
+// Load the document from the file; the GIL is not required.
+static xml_parse_result load_document_file(xml_document &doc, const fs::path &path, unsigned int options,
+                                           xml_encoding encoding, const std::optional<fs::path> &cache_dir,
+                                           Compression compression) {
+  ScopedOperation operation(Operation::load);
+  std::error_code ec;
+  const auto size = fs::file_size(path, ec);
+  operation.add_bytes(ec ? 0 : size);
+  if (cache_dir) {
+    options &= ~parse_fast_scan;
+    return load_file_cached(doc, path, options, encoding, *cache_dir, [&]() {
+      return compression == Compression::none ? doc.load_file(path.string<char>().c_str(), options, encoding)
+                                              : load_compressed_file(doc, path, options, encoding, compression);
+    });
+  }
+  if (compression != Compression::none) {
+    return load_compressed_file(doc, path, options, encoding, compression);
+  }
+  if (options & parse_fast_scan) {
+    std::ifstream file(path, std::ios::binary);
+    std::string data(ec ? 0 : size, '\0');
+    if (!ec && file && file.read(data.data(), static_cast<std::streamsize>(data.size()))) {
+      if (const auto result = load_fast_scan(doc, data.data(), data.size(), options, encoding)) {
+        return *result;
+      }
+      return doc.load_buffer(data.data(), data.size(), options, encoding);
+    }
+    options &= ~parse_fast_scan;
+  }
+  return doc.load_file(path.string<char>().c_str(), options, encoding);
+}
+
+// Call task(i) for each i in [0, count) in its own thread, and task(0) in the calling thread. If a thread cannot be
+// created, the task is called in the calling thread.
+template <typename Task> static void run_parallel(size_t count, const Task &task) {
+  std::vector<std::thread> workers;
+  workers.reserve(count > 0 ? count - 1 : 0);
+  for (size_t i = 1; i < count; ++i) {
+    try {
+      workers.emplace_back(task, i);
+    } catch (const std::system_error &) {
+      task(i);
+    }
+  }
+  if (count > 0) {
+    task(0);
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+// Runs of the records named *split_tag* in *data*: the records are in [first, tail), and the runs are bounded by
+// bounds[i] and bounds[i + 1]. The tail is the end tags of the ancestors, and the comments and PIs after the document
+// element.
+//
+// The split points are found by a text search for "<split_tag", so a run is only known to be safe when it parses as a
+// fragment; a split point in a comment, in CDATA, in a nested record, etc. makes the fragment fail.
+struct RecordRuns {
+  RecordRuns(std::string_view data, const std::string &split_tag, size_t threads) {
+    const auto is_space = [](char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; };
+    const auto pattern = "<" + split_tag;
+    // Return the offset of the first start tag of the record at or after *pos*.
+    const auto find_record = [&](size_t pos) {
+      while ((pos = data.find(pattern, pos)) != std::string_view::npos) {
+        pos += pattern.size();
+        if (pos < data.size() && (is_space(data[pos]) || data[pos] == '>' || data[pos] == '/')) {
+          return pos - pattern.size();
+        }
+      }
+      return data.size();
+    };
+
+    first = find_record(0);
+    tail = data.size();
+    for (auto end = data.size(); end > first;) {
+      while (end > first && is_space(data[end - 1])) {
+        --end;
+      }
+      const auto begin = end > first && data[end - 1] == '>' ? data.rfind('<', end - 1) : std::string_view::npos;
+      if (begin == std::string_view::npos || begin <= first) {
+        break;
+      }
+      auto markup = data.substr(begin, end - begin);
+      if (markup.compare(0, 2, "</") == 0) {
+        markup = markup.substr(2, markup.size() - 3);
+        while (!markup.empty() && is_space(markup.back())) {
+          markup.remove_suffix(1);
+        }
+        if (markup == split_tag) {
+          break;
+        }
+      } else if (markup.compare(0, 4, "<!--") != 0 && markup.compare(0, 2, "<?") != 0) {
+        break;
+      }
+      tail = end = begin;
+    }
+
+    bounds.push_back(first);
+    for (size_t k = 1; first < tail && k < threads; ++k) {
+      const auto pos = find_record(first + (tail - first) / threads * k);
+      if (pos >= tail) {
+        break;
+      }
+      if (pos > bounds.back()) {
+        bounds.push_back(pos);
+      }
+    }
+    bounds.push_back(tail);
+  }
+
+  size_t count() const { return bounds.size() - 1; }
+
+  // Parse the runs of *data* into *fragments* in parallel; return false if any run does not parse.
+  bool parse(std::string_view data, std::vector<xml_document> &fragments, unsigned int options) const {
+    fragments = std::vector<xml_document>(count());
+    std::vector<xml_parse_status> statuses(count(), status_ok);
+    run_parallel(count(), [&](size_t i) {
+      statuses[i] = fragments[i]
+                        .load_buffer(data.data() + bounds[i], bounds[i + 1] - bounds[i],
+                                     (options & ~parse_fast_scan) | parse_fragment, encoding_utf8)
+                        .status;
+    });
+    return std::all_of(statuses.begin(), statuses.end(), [](xml_parse_status status) { return status == status_ok; });
+  }
+
+  size_t first;
+  size_t tail;
+  std::vector<size_t> bounds;
+};
+
+// Load the document from *buffer*, parsing runs of the records named *split_tag* in *threads* threads; the GIL is not
+// required.
+//
+// The runs are parsed as fragments (see RecordRuns) and copied by one thread under the parent of the records in the
+// document parsed from the rest of the buffer. If a run does not parse, the buffer is parsed serially.
+static xml_parse_result load_parallel(xml_document &doc, ParseBuffer &buffer, const std::string &split_tag,
+                                      size_t threads, unsigned int options, xml_encoding encoding) {
+  // Whitespace-only PCDATA of PARSE_WS_PCDATA_SINGLE depends on the siblings in other runs.
+  if (threads < 2 || split_tag.empty() || (options & parse_ws_pcdata_single) ||
+      (encoding != encoding_auto && encoding != encoding_utf8)) {
+    return buffer.load(doc, options, encoding);
+  }
+  const std::string_view data(buffer.data(), buffer.size());
+  const RecordRuns runs(data, split_tag, threads);
+  if (runs.count() < 2) {
+    return buffer.load(doc, options, encoding);
+  }
+
+  // Parse the document with an empty record in place of the records.
+  std::string skeleton;
+  skeleton.reserve(runs.first + split_tag.size() + 3 + data.size() - runs.tail);
+  skeleton.append(data.substr(0, runs.first)).append("<").append(split_tag).append("/>").append(data.substr(runs.tail));
+  const auto result = doc.load_buffer(skeleton.data(), skeleton.size(), options & ~parse_fast_scan, encoding);
+  const auto is_placeholder = [&](const xml_node &node) {
+    return node.type() == node_element && to_utf8(node.name()) == split_tag;
+  };
+  const auto placeholder = result && result.encoding == encoding_utf8 ? doc.find_node(is_placeholder) : xml_node();
+  if (!placeholder) {
+    return buffer.load(doc, options, encoding);
+  }
+
+  std::vector<xml_document> fragments;
+  if (!runs.parse(data, fragments, options)) {
+    return buffer.load(doc, options, encoding);
+  }
+
+  // The nodes cannot be moved between the documents.
+  auto parent = placeholder.parent();
+  for (auto &fragment : fragments) {
+    for (auto child = fragment.first_child(); child; child = child.next_sibling()) {
+      if (!parent.insert_copy_before(child, placeholder)) {
+        return buffer.load(doc, options, encoding);
+      }
+    }
+    fragment.reset();
+  }
+  parent.remove_child(placeholder);
+  return result;
+}
+
+// Load the records named *split_tag* from the UTF-8 file into *fragments*, one document per run of records, without
+// copying them into one document (see load_parallel()); the GIL is not required.
+//
+// If a run does not parse, all the records are parsed as one fragment.
+static xml_parse_result load_file_fragments(std::vector<xml_document> &fragments, const fs::path &path,
+                                            const std::string &split_tag, size_t threads, unsigned int options,
+                                            Compression compression) {
+  ScopedOperation operation(Operation::load);
+  ParseBuffer buffer;
+  xml_parse_result result;
+  result.offset = 0;
+  result.status = read_document_file(path, compression, buffer);
+  if (result.status != status_ok) {
+    return result;
+  }
+  operation.add_bytes(buffer.size());
+  const std::string_view data(buffer.data(), buffer.size());
+  const RecordRuns runs(data, split_tag, std::max<size_t>(threads, 1));
+  result.encoding = encoding_utf8;
+  if (runs.first == runs.tail) {
+    fragments.clear();
+    return result;
+  }
+  if (runs.parse(data, fragments, options)) {
+    return result;
+  }
+  fragments = std::vector<xml_document>(1);
+  result = fragments[0].load_buffer(data.data() + runs.first, runs.tail - runs.first,
+                                    (options & ~parse_fast_scan) | parse_fragment, encoding_utf8);
+  result.offset += static_cast<ptrdiff_t>(runs.first);
+  if (!result) {
+    fragments.clear();
+  }
+  return result;
+}
+
+// Load the document from the file in parallel (see load_parallel()); the GIL is not required.
+static xml_parse_result load_file_parallel(xml_document &doc, const fs::path &path, const std::string &split_tag,
+                                           size_t threads, unsigned int options, xml_encoding encoding,
+                                           Compression compression) {
+  ScopedOperation operation(Operation::load);
+  std::error_code ec;
+  const auto size = fs::file_size(path, ec);
+  operation.add_bytes(ec ? 0 : size);
+  ParseBuffer buffer;
+  xml_parse_result result;
+  result.offset = 0;
+  result.status = read_document_file(path, compression, buffer);
+  if (result.status != status_ok) {
+    doc.reset();
+    return result;
+  }
+  return load_parallel(doc, buffer, split_tag, threads > 0 ? threads : std::thread::hardware_concurrency(), options,
+                       encoding);
+}
+
+// Save the document to the file; the GIL is not required.
+static bool save_document_file(const xml_document &doc, const fs::path &path, const char_t *indent, unsigned int flags,
+                               xml_encoding encoding, Compression compression) {
+  ScopedOperation operation(Operation::save);
+  const auto result = compression == Compression::none
+                          ? doc.save_file(path.string<char>().c_str(), indent, flags, encoding)
+                          : save_compressed_file(doc, path, indent, flags, encoding, compression);
+  std::error_code ec;
+  const auto size = result ? fs::file_size(path, ec) : 0;
+  operation.add_bytes(ec ? 0 : size);
+  return result;
+}
+
+// Run *work* in the default executor of the running event loop and return the asyncio future of its result.
+static py::object run_in_executor(const py::cpp_function &work) {
+  auto loop = py::module_::import("asyncio").attr("get_running_loop")();
+  return loop.attr("run_in_executor")(py::none(), work);
+}
+
+// C-contiguous buffer of the object that supports the buffer protocol
+class ContiguousBuffer {
+public:
+  explicit ContiguousBuffer(const py::handle &obj) {
+    if (PyObject_GetBuffer(obj.ptr(), &view_, PyBUF_SIMPLE) != 0) {
+      throw py::error_already_set();
+    }
+  }
+  ContiguousBuffer(const ContiguousBuffer &) = delete;
+  ContiguousBuffer &operator=(const ContiguousBuffer &) = delete;
+  ~ContiguousBuffer() { PyBuffer_Release(&view_); }
+
+  const char *data() const { return static_cast<const char *>(view_.buf); }
+
+  size_t size() const { return static_cast<size_t>(view_.len); }
+
+private:
+  Py_buffer view_{};
+};
+
+// Document data fed in chunks for XMLFeedParser.
+class FeedParser {
+public:
+  FeedParser(xml_document &doc, unsigned int options, xml_encoding encoding)
+      : doc_(&doc), options_(options), encoding_(encoding) {}
+
+  void feed(const py::handle &data) {
+    if (closed_) {
+      throw py::value_error("feed() after close()");
+    }
+    ContiguousBuffer chunk(data);
+    auto *output = buffer_.reserve(chunk.size());
+    if (!output) {
+      throw std::bad_alloc();
+    }
+    if (chunk.size() > 0) {
+      std::memcpy(output, chunk.data(), chunk.size());
+      buffer_.commit(chunk.size());
+    }
+  }
+
+  // Load the document from the fed data; the GIL must be held and is released while parsing.
+  xml_parse_result close() {
+    set_closed();
+    py::gil_scoped_release release;
+    return load();
+  }
+
+  // Load the document from the fed data after set_closed(); the GIL is not required.
+  xml_parse_result load() {
+    ScopedOperation operation(Operation::load);
+    operation.add_bytes(size_);
+    return buffer_.load(*doc_, options_, encoding_);
+  }
+
+  void set_closed() {
+    if (closed_) {
+      throw py::value_error("close() after close()");
+    }
+    closed_ = true;
+    size_ = buffer_.size();
+  }
+
+  // Undo set_closed() if the document could not be loaded, e.g. there is no running event loop.
+  void reopen() { closed_ = false; }
+
+  bool closed() const { return closed_; }
+
+  size_t size() const { return closed_ ? size_ : buffer_.size(); }
+
+private:
+  xml_document *doc_;
+  unsigned int options_;
+  xml_encoding encoding_;
+  ParseBuffer buffer_;
+  size_t size_ = 0;
+  bool closed_ = false;
+};
+
+// xml_writer that appends the output to a string of char or char_t.
+template <typename String> class StringAppender : public xml_writer {
+public:
+  explicit StringAppender(String &buffer) : buffer_(buffer) {}
+
+  void write(const void *data, size_t size) override {
+    using Char = typename String::value_type;
+    buffer_.append(static_cast<const Char *>(data), size / sizeof(Char));
+  }
+
+private:
+  String &buffer_;
+};
+
+// Serializer of XMLStreamWriter; it follows the formatting of xml_node::print() and lets pugixml escape the values by
+// printing them from scratch nodes. The output is buffered in the native encoding and converted to the output encoding
+// by pugixml when the buffer is written to the writer.
+class StreamWriter {
+public:
+  StreamWriter(xml_writer &writer, const char_t *indent, unsigned int flags, xml_encoding encoding)
+      : writer_(&writer), indent_(indent), flags_(flags), encoding_(encoding), appender_(buffer_) {
+    indent_length_ = (flags & (format_indent | format_indent_attributes)) && !(flags & format_raw) ? indent_.size() : 0;
+    pcdata_ = scratch_.append_child(node_pcdata);
+    element_ = scratch_.append_child(PUGIXML_TEXT("a"));
+    if (flags & format_write_bom) {
+#ifdef PUGIXML_WCHAR_MODE
+      buffer_ += static_cast<char_t>(0xfeff);
+#else
+      buffer_ += "\xef\xbb\xbf";
+#endif // PUGIXML_WCHAR_MODE
+    }
+    if (!(flags & format_no_declaration)) {
+      buffer_ += PUGIXML_TEXT("<?xml version=\"1.0\"");
+      if (encoding == encoding_latin1) {
+        buffer_ += PUGIXML_TEXT(" encoding=\"ISO-8859-1\"");
+      }
+      buffer_ += PUGIXML_TEXT("?>");
+      if (!(flags & format_raw)) {
+        buffer_ += PUGIXML_TEXT('\n');
+      }
+    }
+  }
+  StreamWriter(const StreamWriter &) = delete;
+  StreamWriter &operator=(const StreamWriter &) = delete;
+
+  void start_element(const char_t *name) {
+    check_closed("start_element");
+    close_start_tag();
+    write_indent(stack_.size());
+    buffer_ += PUGIXML_TEXT('<');
+    buffer_ += name;
+    stack_.emplace_back(name);
+    start_tag_ = true;
+    indent_flags_ = indent_newline | indent_indent;
+  }
+
+  void attribute(const char_t *name, const py::handle &value, int precision) {
+    check_closed("attribute");
+    if (!start_tag_) {
+      throw py::value_error("attribute() must follow start_element() or attribute()");
+    }
+    element_.remove_attributes();
+    auto attr = element_.append_attribute(name);
+    set_object_value(value, precision, [&](auto... args) { return attr.set_value(args...); });
+    // <a name="value"/> -> ' name="value"'
+    const auto offset = buffer_.size();
+    element_.print(appender_, PUGIXML_TEXT(""),
+                   (flags_ & ~(format_indent_attributes | format_no_empty_element_tags)) | format_raw, native_encoding);
+    buffer_.resize(buffer_.size() - 2);
+    buffer_.erase(offset, 2);
+    if ((flags_ & (format_indent_attributes | format_raw)) == format_indent_attributes) {
+      buffer_.erase(offset, 1);
+      buffer_.insert(offset, indent_string(stack_.size()));
+      buffer_.insert(offset, 1, PUGIXML_TEXT('\n'));
+    }
+  }
+
+  void text(const py::handle &value, int precision) {
+    check_closed("text");
+    close_start_tag();
+    auto text = pcdata_.text();
+    set_object_value(value, precision, [&](auto... args) { return text.set(args...); });
+    pcdata_.print(appender_, PUGIXML_TEXT(""), flags_ | format_raw, native_encoding);
+    pcdata_.set_value(PUGIXML_TEXT(""));
+    indent_flags_ = 0;
+    flush_full();
+  }
+
+  void end_element() {
+    check_closed("end_element");
+    if (stack_.empty()) {
+      throw py::value_error("end_element() without start_element()");
+    }
+    const auto name = std::move(stack_.back());
+    stack_.pop_back();
+    if (start_tag_) {
+      start_tag_ = false;
+      if (flags_ & format_no_empty_element_tags) {
+        buffer_ += PUGIXML_TEXT("></");
+        buffer_ += name;
+        buffer_ += PUGIXML_TEXT('>');
+      } else {
+        buffer_ += (flags_ & format_raw) ? PUGIXML_TEXT("/>") : PUGIXML_TEXT(" />");
+      }
+    } else {
+      write_indent(stack_.size());
+      buffer_ += PUGIXML_TEXT("</");
+      buffer_ += name;
+      buffer_ += PUGIXML_TEXT('>');
+    }
+    indent_flags_ = indent_newline | indent_indent;
+    flush_full();
+  }
+
+  void write_node(const xml_node &node) {
+    check_closed("write_node");
+    if (!node) {
+      return;
+    }
+    close_start_tag();
+    if ((indent_flags_ & indent_newline) && !(flags_ & format_raw)) {
+      buffer_ += PUGIXML_TEXT('\n');
+    }
+    node.print(appender_, indent_.c_str(), flags_, native_encoding, static_cast<unsigned int>(stack_.size()));
+    const auto type = node.type();
+    indent_flags_ = type == node_pcdata || type == node_cdata ? 0 : indent_indent;
+    flush_full();
+  }
+
+  void flush() {
+    if (buffer_.empty()) {
+      return;
+    }
+#ifndef PUGIXML_WCHAR_MODE
+    if (encoding_ == encoding_auto || encoding_ == encoding_utf8) {
+      writer_->write(buffer_.data(), buffer_.size());
+      buffer_.clear();
+      return;
+    }
+#endif // PUGIXML_WCHAR_MODE
+    pcdata_.set_value(buffer_.data(), buffer_.size());
+    buffer_.clear();
+    pcdata_.print(*writer_, PUGIXML_TEXT(""), format_raw | format_no_escapes, encoding_);
+    pcdata_.set_value(PUGIXML_TEXT(""));
+  }
+
+  void close() {
+    if (closed_) {
+      return;
+    }
+    while (!stack_.empty()) {
+      end_element();
+    }
+    if ((indent_flags_ & indent_newline) && !(flags_ & format_raw)) {
+      buffer_ += PUGIXML_TEXT('\n');
+    }
+    flush();
+    closed_ = true;
+  }
+
+  bool closed() const { return closed_; }
+
+  size_t depth() const { return stack_.size(); }
+
+private:
+  static constexpr unsigned int indent_newline = 1;
+  static constexpr unsigned int indent_indent = 2;
+  static constexpr size_t flush_size = 64 * 1024;
+#ifdef PUGIXML_WCHAR_MODE
+  static constexpr xml_encoding native_encoding = encoding_wchar;
+#else
+  static constexpr xml_encoding native_encoding = encoding_utf8;
+#endif // PUGIXML_WCHAR_MODE
+
+  void check_closed(const char *method) const {
+    if (closed_) {
+      throw py::value_error(std::string(method) + "() after close()");
+    }
+  }
+
+  void close_start_tag() {
+    if (start_tag_) {
+      buffer_ += PUGIXML_TEXT('>');
+      start_tag_ = false;
+    }
+  }
+
+  string_t indent_string(size_t depth) const {
+    string_t result;
+    if (indent_length_ > 0) {
+      result.reserve(indent_length_ * depth);
+      for (size_t i = 0; i < depth; ++i) {
+        result += indent_;
+      }
+    }
+    return result;
+  }
+
+  void write_indent(size_t depth) {
+    if ((indent_flags_ & indent_newline) && !(flags_ & format_raw)) {
+      buffer_ += PUGIXML_TEXT('\n');
+    }
+    if ((indent_flags_ & indent_indent) && indent_length_ > 0) {
+      for (size_t i = 0; i < depth; ++i) {
+        buffer_ += indent_;
+      }
+    }
+  }
+
+  void flush_full() {
+    if (buffer_.size() >= flush_size) {
+      flush();
+    }
+  }
+
+  xml_writer *writer_;
+  string_t indent_;
+  unsigned int flags_;
+  xml_encoding encoding_;
+  size_t indent_length_ = 0;
+  string_t buffer_;
+  StringAppender<string_t> appender_;
+  xml_document scratch_;
+  xml_node pcdata_;
+  xml_node element_;
+  std::vector<string_t> stack_;
+  unsigned int indent_flags_ = indent_indent;
+  bool start_tag_ = false;
+  bool closed_ = false;
+};
+
+// Printer of XMLNode.print_parallel(); it follows the formatting of xml_node::print() like StreamWriter. The children
+// of the split element (the first element that has more than one child) are printed in runs by the threads, and the
+// tags of its ancestors are printed around them. Each node of a run is printed by xml_node::print() and the newline
+// and the indentation around it are fixed up to match its siblings. The calling thread writes the chunks in order as
+// they are finished, and the threads print at most window() runs ahead of it.
+class ParallelPrinter {
+public:
+  ParallelPrinter(const char_t *indent, unsigned int flags, xml_encoding encoding, size_t threads)
+      : indent_(indent), flags_(flags), encoding_(encoding), threads_(threads) {
+    indent_length_ = (flags & (format_indent | format_indent_attributes)) && !(flags & format_raw) ? indent_.size() : 0;
+  }
+  ParallelPrinter(const ParallelPrinter &) = delete;
+  ParallelPrinter &operator=(const ParallelPrinter &) = delete;
+
+  // Print *node* to *writer*; the GIL is not required, and it is acquired for each write unless *native* is true.
+  void print(const xml_node &node, unsigned int depth, xml_writer &writer, bool native) {
+    GilWriter output(writer, native);
+    if (!node) {
+      return;
+    }
+    spine_.assign({node});
+    if (node.type() == node_document && node.document_element()) {
+      spine_.push_back(node.document_element());
+    }
+    while (spine_.back().type() == node_element) {
+      const auto child = spine_.back().first_child();
+      if (!child || child.next_sibling() || child.type() != node_element) {
+        break;
+      }
+      spine_.push_back(child);
+    }
+    const auto &split = spine_.back();
+    // The start tag of an element with PARSE_EMBED_PCDATA cannot be printed without its children.
+    const auto embedded = std::any_of(spine_.begin(), spine_.end(), [](const xml_node &n) { return *n.value() != 0; });
+    if (threads_ < 2 || split.type() != node_element || !split.first_child() || !split.first_child().next_sibling() ||
+        embedded) {
+      node.print(output, indent_.c_str(), flags_, encoding_, depth);
+      return;
+    }
+
+    const auto state = print_spine(0, depth, indent_indent);
+    write_indent(state & indent_newline, 0);
+    flush_text();
+    // The calling thread prints the next run to write when no thread has taken it.
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads_ && i < runs_.size(); ++i) {
+      try {
+        workers.emplace_back([this] { print_runs(); });
+      } catch (const std::system_error &) {
+        break;
+      }
+    }
+    std::exception_ptr error;
+    try {
+      write_chunks(output);
+    } catch (...) {
+      error = std::current_exception();
+      std::lock_guard<std::mutex> lock(mutex_);
+      aborted_ = true;
+      changed_.notify_all();
+    }
+    for (auto &worker : workers) {
+      worker.join();
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+private:
+  // Writer that acquires the GIL for each write unless the writer is native.
+  class GilWriter : public xml_writer {
+  public:
+    GilWriter(xml_writer &writer, bool native) : writer_(writer), native_(native) {}
+
+    void write(const void *data, size_t size) override {
+      if (native_) {
+        writer_.write(data, size);
+      } else {
+        py::gil_scoped_acquire acquire;
+        writer_.write(data, size);
+      }
+    }
+
+  private:
+    xml_writer &writer_;
+    bool native_;
+  };
+
+  struct Chunk {
+    std::string data;
+    bool ready;
+  };
+
+  // Siblings [first, last) that follow a node that left *state* of the indentation.
+  struct Run {
+    xml_node first;
+    xml_node last;
+    unsigned int depth;
+    unsigned int state;
+    size_t chunk;
+  };
+
+  static constexpr unsigned int indent_newline = 1;
+  static constexpr unsigned int indent_indent = 2;
+  static constexpr size_t write_size = 64 * 1024;
+  // The number of runs per thread; smaller runs are written sooner after they are printed.
+  static constexpr size_t runs_per_thread = 8;
+#ifdef PUGIXML_WCHAR_MODE
+  static constexpr xml_encoding native_encoding = encoding_wchar;
+#else
+  static constexpr xml_encoding native_encoding = encoding_utf8;
+#endif // PUGIXML_WCHAR_MODE
+
+  static unsigned int state_after(const xml_node &node) {
+    const auto type = node.type();
+    return type == node_pcdata || type == node_cdata ? 0 : indent_newline | indent_indent;
+  }
+
+  static string_t end_tag(const xml_node &node) {
+    string_t result = PUGIXML_TEXT("</");
+    result += *node.name() ? node.name() : PUGIXML_TEXT(":anonymous");
+    result += PUGIXML_TEXT('>');
+    return result;
+  }
+
+  // Print spine_[level] at *depth* after a node that left *state*, and return the state after it.
+  unsigned int print_spine(size_t level, unsigned int depth, unsigned int state) {
+    const auto &node = spine_[level];
+    if (node.type() == node_element) {
+      write_indent(state, depth);
+      write_start_tag(node, depth);
+      state = indent_newline | indent_indent;
+      ++depth;
+    } else {
+      state = indent_indent;
+    }
+
+    if (level + 1 == spine_.size()) {
+      size_t count = 0;
+      for (auto child = node.first_child(); child; child = child.next_sibling()) {
+        ++count;
+      }
+      const auto runs = std::min(count, threads_ * runs_per_thread);
+      auto first = node.first_child();
+      for (size_t i = 0; i < runs; ++i) {
+        auto last = first;
+        auto next_state = state;
+        for (auto size = count / runs + (i < count % runs ? 1 : 0); size > 0; --size) {
+          next_state = state_after(last);
+          last = last.next_sibling();
+        }
+        add_run(first, last, depth, state);
+        first = last;
+        state = next_state;
+      }
+    } else {
+      xml_node first;
+      auto first_state = state;
+      for (auto child = node.first_child(); child; child = child.next_sibling()) {
+        if (child == spine_[level + 1]) {
+          if (first) {
+            add_run(first, child, depth, first_state);
+            first = xml_node();
+          }
+          state = print_spine(level + 1, depth, state);
+          continue;
+        }
+        if (!first) {
+          first = child;
+          first_state = state;
+        }
+        state = state_after(child);
+      }
+      if (first) {
+        add_run(first, xml_node(), depth, first_state);
+      }
+    }
+
+    if (node.type() == node_element) {
+      write_indent(state, --depth);
+      text_ += end_tag(node);
+      state = indent_newline | indent_indent;
+    }
+    return state;
+  }
+
+  void write_indent(unsigned int state, unsigned int depth) {
+    if ((state & indent_newline) && !(flags_ & format_raw)) {
+      text_ += PUGIXML_TEXT('\n');
+    }
+    if ((state & indent_indent) && indent_length_ > 0) {
+      for (unsigned int i = 0; i < depth; ++i) {
+        text_ += indent_;
+      }
+    }
+  }
+
+  // Print the start tag of *node* by printing a copy of it without children but a PCDATA child.
+  void write_start_tag(const xml_node &node, unsigned int depth) {
+    xml_document scratch;
+    auto element = scratch.append_child(node_element);
+    element.set_name(node.name());
+    for (const auto &attr : node.attributes()) {
+      element.append_attribute(attr.name()).set_value(attr.value());
+    }
+    element.append_child(node_pcdata).set_value(PUGIXML_TEXT("x"));
+    // "<indent><name attrs>x</name>\n" -> "<name attrs>"
+    string_t tag;
+    StringAppender<string_t> appender(tag);
+    element.print(appender, indent_.c_str(), flags_, native_encoding, depth);
+    const auto prefix = indent_length_ * depth;
+    const auto suffix = 1 + end_tag(node).size() + ((flags_ & format_raw) ? 0 : 1);
+    text_.append(tag, prefix, tag.size() - prefix - suffix);
+  }
+
+  void add_run(const xml_node &first, const xml_node &last, unsigned int depth, unsigned int state) {
+    flush_text();
+    runs_.push_back({first, last, depth, state, chunks_.size()});
+    chunks_.push_back({std::string(), false});
+  }
+
+  void flush_text() {
+    if (!text_.empty()) {
+      chunks_.push_back({encode(std::move(text_)), true});
+      text_.clear();
+    }
+  }
+
+  // Take the runs in order and print them until all runs are taken.
+  void print_runs() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!aborted_ && next_run_ < runs_.size()) {
+      const auto i = next_run_++;
+      changed_.wait(lock, [&] { return aborted_ || i < written_runs_ + window(); });
+      if (!aborted_) {
+        fill_chunk(i, lock);
+      }
+    }
+  }
+
+  // Print run #i into its chunk; *lock* is released while printing.
+  void fill_chunk(size_t i, std::unique_lock<std::mutex> &lock) {
+    lock.unlock();
+    auto output = print_run(runs_[i]);
+    lock.lock();
+    chunks_[runs_[i].chunk] = {std::move(output), true};
+    changed_.notify_all();
+  }
+
+  // Write the chunks to *writer* in order, releasing each one after it is written.
+  void write_chunks(xml_writer &writer) {
+    for (size_t index = 0; index < chunks_.size(); ++index) {
+      std::string data;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!chunks_[index].ready) {
+          if (next_run_ == written_runs_) {
+            fill_chunk(next_run_++, lock);
+          } else {
+            changed_.wait(lock);
+          }
+        }
+        data = std::move(chunks_[index].data);
+        chunks_[index].data = std::string();
+      }
+      for (size_t offset = 0; offset < data.size(); offset += write_size) {
+        writer.write(data.data() + offset, std::min(write_size, data.size() - offset));
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (written_runs_ < runs_.size() && runs_[written_runs_].chunk == index) {
+        ++written_runs_;
+        changed_.notify_all();
+      }
+    }
+  }
+
+  size_t window() const { return 2 * threads_; }
+
+  std::string print_run(const Run &run) {
+    string_t output;
+    StringAppender<string_t> appender(output);
+    auto state = run.state;
+    for (auto child = run.first; child != run.last; child = child.next_sibling()) {
+      const auto next_state = state_after(child);
+      if (next_state == 0) {
+        child.print(appender, indent_.c_str(), flags_, native_encoding, run.depth);
+        state = next_state;
+        continue;
+      }
+      // xml_node::print() starts with the indentation and ends with a newline.
+      if ((state & indent_newline) && !(flags_ & format_raw)) {
+        output += PUGIXML_TEXT('\n');
+      }
+      const auto offset = output.size();
+      child.print(appender, indent_.c_str(), flags_, native_encoding, run.depth);
+      if (!(state & indent_indent) && indent_length_ > 0) {
+        output.erase(offset, indent_length_ * run.depth);
+      }
+      if (!(flags_ & format_raw)) {
+        output.pop_back();
+      }
+      state = next_state;
+    }
+    return encode(std::move(output));
   }
 
-  void reset() { index_ = 0; }
+  // Convert *text* to the output encoding as xml_node::print() does.
+  std::string encode(string_t text) const {
+#ifndef PUGIXML_WCHAR_MODE
+    if (encoding_ == encoding_auto || encoding_ == encoding_utf8) {
+      return text;
+    }
+#endif // PUGIXML_WCHAR_MODE
+    xml_document scratch;
+    auto pcdata = scratch.append_child(node_pcdata);
+    pcdata.set_value(text.data(), text.size());
+    text = string_t();
+    std::string result;
+    StringAppender<std::string> appender(result);
+    pcdata.print(appender, PUGIXML_TEXT(""), format_raw | format_no_escapes, encoding_);
+    return result;
+  }
 
-  auto size() const { return items_.size(); }
+  string_t indent_;
+  unsigned int flags_;
+  xml_encoding encoding_;
+  size_t threads_;
+  size_t indent_length_ = 0;
+  std::vector<xml_node> spine_;
+  std::vector<Run> runs_;
+  std::vector<Chunk> chunks_;
+  string_t text_;
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  size_t next_run_ = 0;
+  size_t written_runs_ = 0;
+  bool aborted_ = false;
 };
 
 class PyXMLWriter : public xml_writer {
@@ -121,22 +3081,66 @@ public:
   }
 };
 
+// pugixml.pugi.BytesWriter and pugixml.pugi.FileWriter do not call Python, so they are used without the GIL.
+struct BytesWriter : public xml_writer {
+  std::string contents;
+  void write(const void *data, size_t size) override { contents.append(static_cast<const char *>(data), size); }
+};
+
+struct FileWriter : public xml_writer {
+  std::ofstream file;
+  FileWriter(const fs::path &path) {
+    try {
+      file.open(path, std::ios_base::out | std::ios_base::binary);
+      file.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    } catch (const std::exception &e) {
+      PyErr_SetString(PyExc_OSError, e.what());
+      throw py::error_already_set();
+    }
+  }
+  void close() {
+    if (file.is_open()) {
+      file.close();
+    }
+  }
+  void write(const void *data, size_t size) override {
+    try {
+      file.write(static_cast<const char *>(data), size);
+    } catch (const std::exception &e) {
+      py::gil_scoped_acquire acquire;
+      PyErr_SetString(PyExc_OSError, e.what());
+      throw py::error_already_set();
+    }
+  }
+};
+
+static bool is_native_writer(const xml_writer &writer) {
+  return dynamic_cast<const BytesWriter *>(&writer) || dynamic_cast<const FileWriter *>(&writer);
+}
+
 class PyXMLTreeWalker : public xml_tree_walker {
 public:
   using xml_tree_walker::xml_tree_walker;
 
   bool begin(xml_node &node) override { PYBIND11_OVERRIDE(bool, xml_tree_walker, begin, node); }
 
-  bool for_each(xml_node &node) override { PYBIND11_OVERRIDE_PURE(bool, xml_tree_walker, for_each, node); }
+  bool for_each(xml_node &node) override {
+    ++visited;
+    PYBIND11_OVERRIDE_PURE(bool, xml_tree_walker, for_each, node);
+  }
 
   bool end(xml_node &node) override { PYBIND11_OVERRIDE(bool, xml_tree_walker, end, node); }
 
   using xml_tree_walker::depth;
+
+  uint64_t visited = 0;
 };
 
 PYBIND11_MODULE(MODULE_NAME, m) {
   py::options options;
 
+  set_memory_management_functions(allocate_memory, deallocate_memory);
+
   //
   // pugixml.pugi module
   //
@@ -144,6 +3148,29 @@ PYBIND11_MODULE(MODULE_NAME, m) {
 
   m.attr("PUGIXML_VERSION") = PUGIXML_VERSION;
 
+  py::dict build_options;
+#ifdef PUGIXML_COMPACT
+  build_options["PUGIXML_COMPACT"] = true;
+#else
+  build_options["PUGIXML_COMPACT"] = false;
+#endif // PUGIXML_COMPACT
+#ifdef PUGIXML_WCHAR_MODE
+  build_options["PUGIXML_WCHAR_MODE"] = true;
+#else
+  build_options["PUGIXML_WCHAR_MODE"] = false;
+#endif // PUGIXML_WCHAR_MODE
+#ifdef PUGIXML_ZLIB
+  build_options["PUGIXML_ZLIB"] = true;
+#else
+  build_options["PUGIXML_ZLIB"] = false;
+#endif // PUGIXML_ZLIB
+#ifdef PUGIXML_ZSTD
+  build_options["PUGIXML_ZSTD"] = true;
+#else
+  build_options["PUGIXML_ZSTD"] = false;
+#endif // PUGIXML_ZSTD
+  m.attr("BUILD_OPTIONS") = build_options;
+
   // Parsing options
   m.attr("PARSE_MINIMAL") = parse_minimal;
   m.attr("PARSE_PI") = parse_pi;
@@ -163,6 +3190,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   m.attr("PARSE_MERGE_PCDATA") = parse_merge_pcdata;
   m.attr("PARSE_DEFAULT") = parse_default;
   m.attr("PARSE_FULL") = parse_full;
+  m.attr("PARSE_FAST_SCAN") = parse_fast_scan;
 
   // Formatting flags
   m.attr("FORMAT_INDENT") = format_indent;
@@ -301,6 +3329,21 @@ PYBIND11_MODULE(MODULE_NAME, m) {
           :meth:`XMLDocument.save`, :meth:`XMLNode.print`
       )doc");
 
+  py::class_<StreamWriter> swt(m, "XMLStreamWriter", R"doc(
+      (pugixml-python only) Streaming serializer that writes the XML document to :class:`XMLWriter` as it is built.
+
+      The elements, attributes and texts are written as the events arrive, and the completed subtrees built as small
+      :class:`XMLNode` objects are written with :meth:`.write_node`; only the names of the open elements and a small
+      output buffer are kept in memory. The output is formatted as :meth:`XMLDocument.save` with the same flags,
+      and the values are escaped by pugixml.
+
+      Important:
+          Call :meth:`.close` to end the open elements and write the buffered output to the writer.
+
+      See Also:
+          :class:`BytesWriter`, :class:`FileWriter`, :meth:`XMLDocument.save`
+      )doc");
+
   py::class_<xml_attribute> attr(m, "XMLAttribute", "A light-weight handle for manipulating attributes in DOM tree.");
 
   py::class_<xml_node> node(m, "XMLNode", "A light-weight handle for manipulating nodes in DOM tree.");
@@ -342,6 +3385,17 @@ PYBIND11_MODULE(MODULE_NAME, m) {
 
   py::class_<xml_document, xml_node> xdoc(m, "XMLDocument", "Document class (DOM tree root).");
 
+  py::class_<FeedParser> fdp(m, "XMLFeedParser", R"doc(
+      (pugixml-python only) Feed interface for loading a document received in chunks.
+
+      pugixml has no incremental parser: :meth:`.feed` appends the chunks to a native buffer without parsing, and
+      :meth:`.close` or :meth:`.close_async` parses the whole buffer into the document in place, without copying it
+      again.
+
+      See Also:
+          :meth:`XMLDocument.load_buffer`, :meth:`XMLDocument.load_file_async`
+      )doc");
+
   py::class_<xpath_parse_result> xppr(m, "XPathParseResult", "XPath parsing result.");
 
   py::class_<xpath_variable> xpv(m, "XPathVariable", R"doc(
@@ -457,9 +3511,10 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   // pugi::xml_object_range<xml_attribute_iterator>
   // pugi::xml_attribute_iterator
   //
-  atit.def("__getitem__", &Iterator<xml_attribute_iterator, xml_attribute>::operator[], py::arg("index"),
+  atit.def("__getitem__", &Iterator<xml_attribute_iterator, xml_attribute>::operator[], py::keep_alive<0, 1>(),
+           py::arg("index"),
            "\tReturn the attribute at the specified index from the collection.")
-      .def("__getitem__", &Iterator<xml_attribute_iterator, xml_attribute>::get, py::arg("slice"),
+      .def("__getitem__", &get_slice, py::arg("slice"),
            "\tReturn a list of attributes at the specified :obj:`slice` from the collection.\n\n"
            "Args:\n"
            "    index (int): An index to specify position.\n"
@@ -489,7 +3544,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                int: The collection size.
            )doc");
 
-  atit.def("__next__", &Iterator<xml_attribute_iterator, xml_attribute>::next,
+  atit.def("__next__", &Iterator<xml_attribute_iterator, xml_attribute>::next, py::keep_alive<0, 1>(),
            R"doc(
            Return the next attribute from the collection.
 
@@ -501,9 +3556,9 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   // pugi::xml_object_range<xml_node_iterator>
   // pugi::xml_node_iterator
   //
-  nit.def("__getitem__", &Iterator<xml_node_iterator, xml_node>::operator[], py::arg("index"),
+  nit.def("__getitem__", &Iterator<xml_node_iterator, xml_node>::operator[], py::keep_alive<0, 1>(), py::arg("index"),
           "\tReturn the node at the specified index from the collection.")
-      .def("__getitem__", &Iterator<xml_node_iterator, xml_node>::get, py::arg("slice"),
+      .def("__getitem__", &get_slice, py::arg("slice"),
            "\tReturn a list of nodes at the specified :obj:`slice` from the collection.\n\n"
            "Args:\n"
            "    index (int): An index to specify position.\n"
@@ -533,7 +3588,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                int: The collection size.
            )doc");
 
-  nit.def("__next__", &Iterator<xml_node_iterator, xml_node>::next,
+  nit.def("__next__", &Iterator<xml_node_iterator, xml_node>::next, py::keep_alive<0, 1>(),
           R"doc(
           Return the next node from the collection.
 
@@ -545,9 +3600,10 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   // pugi::xml_object_range<xml_named_node_iterator>
   // pugi::xml_named_node_iterator
   //
-  nnit.def("__getitem__", &Iterator<xml_named_node_iterator, xml_node>::operator[], py::arg("index"),
+  nnit.def("__getitem__", &Iterator<xml_named_node_iterator, xml_node>::operator[], py::keep_alive<0, 1>(),
+           py::arg("index"),
            "\tReturn the node at the specified index from the collection.")
-      .def("__getitem__", &Iterator<xml_named_node_iterator, xml_node>::get, py::arg("slice"),
+      .def("__getitem__", &get_slice, py::arg("slice"),
            "\tReturn a list of nodes at the specified :obj:`slice` from the collection.\n\n"
            "Args:\n"
            "    index (int): An index to specify position.\n"
@@ -577,7 +3633,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                int: The collection size.
            )doc");
 
-  nnit.def("__next__", &Iterator<xml_named_node_iterator, xml_node>::next,
+  nnit.def("__next__", &Iterator<xml_named_node_iterator, xml_node>::next, py::keep_alive<0, 1>(),
            R"doc(
            Return the next node from the collection.
 
@@ -603,6 +3659,120 @@ PYBIND11_MODULE(MODULE_NAME, m) {
           )doc");
   options.enable_function_signatures();
 
+  //
+  // XMLStreamWriter
+  //
+  swt.def(py::init<xml_writer &, const char_t *, unsigned int, xml_encoding>(), py::keep_alive<1, 2>(),
+          py::arg("writer"), py::arg("indent").none(false) = PUGIXML_TEXT("\t"),
+          py::arg_v("flags", format_default, "pugixml.pugi.FORMAT_DEFAULT"), py::arg("encoding") = encoding_auto,
+          R"doc(
+          Initialize ``XMLStreamWriter``.
+
+          The BOM and the XML declaration are written unless disabled by *flags*.
+
+          Args:
+              writer (XMLWriter): The writer object which implements :class:`XMLWriter` interface.
+              indent (str): The indentation character(s).
+              flags (int): The :pugixml:`output options <manual.html#saving.options>`.
+              encoding (XMLEncoding): The :pugixml:`output encoding <manual.html#saving.encoding>`.
+          )doc");
+
+  swt.def_property_readonly("closed", &StreamWriter::closed, R"doc(
+      bool: :obj:`True` if the stream writer is closed, :obj:`False` otherwise.
+      )doc");
+
+  swt.def_property_readonly("depth", &StreamWriter::depth, R"doc(
+      int: The number of the open elements.
+      )doc");
+
+  swt.def("start_element", &StreamWriter::start_element, py::arg("name").none(false),
+          R"doc(
+          Start an element.
+
+          Args:
+              name (str): The element name.
+
+          Raises:
+              ValueError: If the stream writer is closed.
+          )doc");
+
+  options.disable_function_signatures();
+  swt.def("attribute", &StreamWriter::attribute, py::arg("name").none(false), py::arg("value"),
+          py::arg("precision") = default_double_precision,
+          R"doc(
+          attribute(self: pugixml.pugi.XMLStreamWriter, name: str, value: typing.Union[str, bool, int, float], precision: int = 17) -> None
+
+          Add an attribute to the element just started.
+
+          Args:
+              name (str): The attribute name.
+              value (typing.Union[str, bool, int, float]): The attribute value.
+              precision (int): The number of significant digits for :obj:`float` values.
+
+          Raises:
+              TypeError: If the value has an unsupported type.
+              ValueError: If the stream writer is closed, or the start tag is already ended by a child or a text.
+          )doc");
+
+  swt.def("text", &StreamWriter::text, py::arg("value"), py::arg("precision") = default_double_precision,
+          R"doc(
+          text(self: pugixml.pugi.XMLStreamWriter, value: typing.Union[str, bool, int, float], precision: int = 17) -> None
+
+          Write a text (PCDATA) to the current element.
+
+          Args:
+              value (typing.Union[str, bool, int, float]): The text.
+              precision (int): The number of significant digits for :obj:`float` values.
+
+          Raises:
+              TypeError: If the value has an unsupported type.
+              ValueError: If the stream writer is closed.
+          )doc");
+  options.enable_function_signatures();
+
+  swt.def("end_element", &StreamWriter::end_element,
+          R"doc(
+          End the current element.
+
+          Raises:
+              ValueError: If the stream writer is closed, or there is no open element.
+          )doc");
+
+  swt.def("write_node", &StreamWriter::write_node, py::arg("node"),
+          R"doc(
+          Write *node* and its subtree to the current element.
+
+          The subtree is printed by :meth:`XMLNode.print` at the current depth, so the document of *node* can be
+          reset and reused for the next subtree.
+
+          Args:
+              node (XMLNode): The node to write.
+
+          Raises:
+              ValueError: If the stream writer is closed.
+          )doc");
+
+  swt.def("flush", &StreamWriter::flush, "Write the buffered output to the writer.");
+
+  swt.def("close", &StreamWriter::close,
+          R"doc(
+          End all open elements and write the buffered output to the writer.
+
+          The writer itself is not closed. Calling this method more than once has no effect.
+
+          Examples:
+              >>> from contextlib import closing
+              >>> from pugixml import pugi
+              >>> with closing(pugi.FileWriter('export.xml')) as writer:
+              ...     with closing(pugi.XMLStreamWriter(writer)) as stream:
+              ...         stream.start_element('rows')
+              ...         for i in range(1000000):
+              ...             stream.start_element('row')
+              ...             stream.attribute('id', i)
+              ...             stream.text(f'row {i}')
+              ...             stream.end_element()
+          )doc");
+
   //
   // pugi::xml_attribute
   //
@@ -721,8 +3891,8 @@ PYBIND11_MODULE(MODULE_NAME, m) {
     }
 
     const auto name = self.name();
-    if (!self.empty() && strlen(name)) {
-      ss << " name=" << std::quoted(name, '\'');
+    if (!self.empty() && *name) {
+      ss << " name=" << std::quoted(to_utf8(name), '\'');
     }
 
     ss << ">";
@@ -737,24 +3907,28 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                bool: :obj:`True` if attribute is empty, :obj:`False` otherwise.
            )doc");
 
-  attr.def("name", &xml_attribute::name,
-           R"doc(
-           Return the attribute name.
+  attr.def(
+      "name", [](const xml_attribute &self) { return _name_cache->get(self.name()); },
+      R"doc(
+      Return the attribute name.
 
-           Returns:
-               str: The attribute name, or the empty string if attribute is empty.
-           )doc");
+      The names are interned, so the same :obj:`str` object is returned for the same name.
 
-  attr.def("value", &xml_attribute::value,
-           R"doc(
-           Return the attribute value.
+      Returns:
+          str: The attribute name, or the empty string if attribute is empty.
+      )doc");
 
-           Returns:
-               str: The attribute value, or the empty string if attribute is empty.
+  attr.def(
+      "value", [](const xml_attribute &self) { return to_str(self.value()); },
+      R"doc(
+      Return the attribute value.
 
-           See Also:
-               :meth:`.as_string`
-           )doc");
+      Returns:
+          str: The attribute value, or the empty string if attribute is empty.
+
+      See Also:
+          :meth:`.as_string`
+      )doc");
 
   attr.def("as_string", &xml_attribute::as_string, py::arg("default").none(false) = PUGIXML_TEXT(""),
            R"doc(
@@ -878,7 +4052,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "Returns:\n"
            "    bool: :obj:`False` if attribute is empty or there is not enough memory.");
 
-  attr.def("next_attribute", &xml_attribute::next_attribute,
+  attr.def("next_attribute", &xml_attribute::next_attribute, py::keep_alive<0, 1>(),
            R"doc(
            Return the next attribute in the list of attributes of the parent node.
 
@@ -886,7 +4060,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                XMLAttribute: The next sibling of this attribute, or empty attribute if not exists.
            )doc");
 
-  attr.def("previous_attribute", &xml_attribute::previous_attribute,
+  attr.def("previous_attribute", &xml_attribute::previous_attribute, py::keep_alive<0, 1>(),
            R"doc(
            Return the previous attribute in the list of attributes of the parent node.
 
@@ -1038,8 +4212,8 @@ PYBIND11_MODULE(MODULE_NAME, m) {
     }
 
     const auto node_name = self.name();
-    if (!self.empty() && strlen(node_name)) {
-      ss << " name=" << std::quoted(node_name, '\'');
+    if (!self.empty() && *node_name) {
+      ss << " name=" << std::quoted(to_utf8(node_name), '\'');
     }
 
     ss << ">";
@@ -1054,7 +4228,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                bool: :obj:`True` if node is empty, :obj:`False` otherwise.
            )doc");
 
-  node.def("ensure_attribute", py::overload_cast<const char *>(&xml_node::ensure_attribute),
+  node.def("ensure_attribute", py::overload_cast<const char_t *>(&xml_node::ensure_attribute), py::keep_alive<0, 1>(),
            py::arg("name").none(false),
            R"doc(
            Return the attribute with the specified name.
@@ -1071,7 +4245,8 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.attribute`
            )doc");
 
-  node.def("ensure_child", py::overload_cast<const char *>(&xml_node::ensure_child), py::arg("name").none(false),
+  node.def("ensure_child", py::overload_cast<const char_t *>(&xml_node::ensure_child), py::keep_alive<0, 1>(),
+           py::arg("name").none(false),
            R"doc(
            Return the child node with the specified name.
 
@@ -1095,26 +4270,30 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                XMLNodeType: The node type.
            )doc");
 
-  node.def("name", &xml_node::name,
-           R"doc(
-           Return the node name.
+  node.def(
+      "name", [](const xml_node &self) { return _name_cache->get(self.name()); },
+      R"doc(
+      Return the node name.
 
-           Returns:
-               str: The node name, or the empty string if node is empty or it has no name.
-           )doc");
+      The names are interned, so the same :obj:`str` object is returned for the same name.
 
-  node.def("value", &xml_node::value,
-           R"doc(
-           Return the node value.
+      Returns:
+          str: The node name, or the empty string if node is empty or it has no name.
+      )doc");
 
-           Returns:
-               str: The node value, or the empty string if node is empty or it has no value.
+  node.def(
+      "value", [](const xml_node &self) { return to_str(self.value()); },
+      R"doc(
+      Return the node value.
 
-           Note:
-               For <node>text</node> :meth:`.value` does not return "text"! Use :meth:`.child_value` or :meth:`.text` methods to access text inside nodes.
-           )doc");
+      Returns:
+          str: The node value, or the empty string if node is empty or it has no value.
+
+      Note:
+          For <node>text</node> :meth:`.value` does not return "text"! Use :meth:`.child_value` or :meth:`.text` methods to access text inside nodes.
+      )doc");
 
-  node.def("first_attribute", &xml_node::first_attribute,
+  node.def("first_attribute", &xml_node::first_attribute, py::keep_alive<0, 1>(),
            R"doc(
            Return the first attribute in the list of attributes for this node.
 
@@ -1125,7 +4304,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.last_attribute`
            )doc");
 
-  node.def("last_attribute", &xml_node::last_attribute,
+  node.def("last_attribute", &xml_node::last_attribute, py::keep_alive<0, 1>(),
            R"doc(
            Return the last attribute in the list of attributes for this node.
 
@@ -1136,7 +4315,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.first_attribute`
            )doc");
 
-  node.def("first_child", &xml_node::first_child,
+  node.def("first_child", &xml_node::first_child, py::keep_alive<0, 1>(),
            R"doc(
            Return the first child node.
 
@@ -1147,7 +4326,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.last_child`
            )doc");
 
-  node.def("last_child", &xml_node::last_child,
+  node.def("last_child", &xml_node::last_child, py::keep_alive<0, 1>(),
            R"doc(
            Return the last child node.
 
@@ -1158,10 +4337,10 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.first_child`
            )doc");
 
-  node.def("next_sibling", py::overload_cast<>(&xml_node::next_sibling, py::const_),
+  node.def("next_sibling", py::overload_cast<>(&xml_node::next_sibling, py::const_), py::keep_alive<0, 1>(),
            "\tReturn the next sibling node in the document tree.")
       .def("next_sibling", py::overload_cast<const char_t *>(&xml_node::next_sibling, py::const_),
-           py::arg("name").none(false),
+           py::keep_alive<0, 1>(), py::arg("name").none(false),
            "\tReturn the next sibling node with the specified name in the document tree.\n\n"
            "Args:\n"
            "    name (str): The name of the target node.\n\n"
@@ -1170,10 +4349,10 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "See Also:\n"
            "    :meth:`.previous_sibling`");
 
-  node.def("previous_sibling", py::overload_cast<>(&xml_node::previous_sibling, py::const_),
+  node.def("previous_sibling", py::overload_cast<>(&xml_node::previous_sibling, py::const_), py::keep_alive<0, 1>(),
            "\tReturn the previous sibling node in the document tree.")
       .def("previous_sibling", py::overload_cast<const char_t *>(&xml_node::previous_sibling, py::const_),
-           py::arg("name").none(false),
+           py::keep_alive<0, 1>(), py::arg("name").none(false),
            "\tReturn the previous sibling node with the specified name in the document tree.\n\n"
            "Args:\n"
            "    name (str): The name of the target node.\n\n"
@@ -1182,7 +4361,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "See Also:\n"
            "    :meth:`.next_sibling`");
 
-  node.def("parent", &xml_node::parent,
+  node.def("parent", &xml_node::parent, py::keep_alive<0, 1>(),
            R"doc(
            Return the parent node.
 
@@ -1190,7 +4369,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                XMLNode: The parent node, or empty node if not exists.
            )doc");
 
-  node.def("root", &xml_node::root,
+  node.def("root", &xml_node::root, py::keep_alive<0, 1>(),
            R"doc(
            Return the root of DOM tree this node belongs to.
 
@@ -1198,7 +4377,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                XMLNode: The root node, or empty node if not exists.
            )doc");
 
-  node.def("text", &xml_node::text,
+  node.def("text", &xml_node::text, py::keep_alive<0, 1>(),
            R"doc(
            Return the text object for the current node.
 
@@ -1206,7 +4385,8 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                XMLText: The text object.
            )doc");
 
-  node.def("child", py::overload_cast<const char_t *>(&xml_node::child, py::const_), py::arg("name").none(false),
+  node.def("child", py::overload_cast<const char_t *>(&xml_node::child, py::const_), py::keep_alive<0, 1>(),
+           py::arg("name").none(false),
            R"doc(
            Return a child node with the specified name.
 
@@ -1220,10 +4400,10 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.ensure_child`
            )doc");
 
-  node.def("attribute", py::overload_cast<const char_t *>(&xml_node::attribute, py::const_),
+  node.def("attribute", py::overload_cast<const char_t *>(&xml_node::attribute, py::const_), py::keep_alive<0, 1>(),
            py::arg("name").none(false), "\tReturn the attribute with the specified name for this node.")
       .def("attribute", py::overload_cast<const char_t *, xml_attribute &>(&xml_node::attribute, py::const_),
-           py::arg("name").none(false), py::arg("hint"),
+           py::keep_alive<0, 1>(), py::arg("name").none(false), py::arg("hint"),
            "\tReturn the attribute with the specified name and *hint* for this node.\n\n"
            "Args:\n"
            "    name (str): The attribute name to find.\n"
@@ -1253,10 +4433,12 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "    >>> hint.empty()\n"
            "    True\n");
 
-  node.def("child_value", py::overload_cast<>(&xml_node::child_value, py::const_),
-           "\tReturn the value of the first child node with node type :attr:`NODE_PCDATA` or :attr:`NODE_CDATA`.")
-      .def("child_value", py::overload_cast<const char_t *>(&xml_node::child_value, py::const_),
-           py::arg("name").none(false),
+  node.def(
+          "child_value", [](const xml_node &self) { return to_str(self.child_value()); },
+          "\tReturn the value of the first child node with node type :attr:`NODE_PCDATA` or :attr:`NODE_CDATA`.")
+      .def(
+          "child_value", [](const xml_node &self, const char_t *name) { return to_str(self.child_value(name)); },
+          py::arg("name").none(false),
            "\tReturn the value of the child node with the specified name.\n\n"
            "Args:\n"
            "    name (str): The node name to find.\n\n"
@@ -1298,7 +4480,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "Returns:\n"
            "    bool: :obj:`False` if node is empty, there is not enough memory, or node can not have value.");
 
-  node.def("append_attribute", py::overload_cast<const char_t *>(&xml_node::append_attribute),
+  node.def("append_attribute", py::overload_cast<const char_t *>(&xml_node::append_attribute), py::keep_alive<0, 1>(),
            py::arg("name").none(false),
            R"doc(
            Add a new attribute with the specified name to the end of the list of attributes for this node.
@@ -1313,7 +4495,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.prepend_attribute`, :meth:`.insert_attribute_after`, :meth:`.insert_attribute_before`
            )doc");
 
-  node.def("prepend_attribute", py::overload_cast<const char_t *>(&xml_node::prepend_attribute),
+  node.def("prepend_attribute", py::overload_cast<const char_t *>(&xml_node::prepend_attribute), py::keep_alive<0, 1>(),
            py::arg("name").none(false),
            R"doc(
            Add a new attribute with the specified name to the top of the list of attributes for this node.
@@ -1330,7 +4512,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
 
   node.def("insert_attribute_after",
            py::overload_cast<const char_t *, const xml_attribute &>(&xml_node::insert_attribute_after),
-           py::arg("name").none(false), py::arg("attr"),
+           py::keep_alive<0, 1>(), py::arg("name").none(false), py::arg("attr"),
            R"doc(
            Insert a new attribute with the specified name after *attr* in the list of attributes for this node.
 
@@ -1347,7 +4529,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
 
   node.def("insert_attribute_before",
            py::overload_cast<const char_t *, const xml_attribute &>(&xml_node::insert_attribute_before),
-           py::arg("name").none(false), py::arg("attr"),
+           py::keep_alive<0, 1>(), py::arg("name").none(false), py::arg("attr"),
            R"doc(
            Insert a new attribute with the specified name before *attr* in the list of attributes for this node.
 
@@ -1362,9 +4544,11 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.append_attribute`, :meth:`.prepend_attribute`, :meth:`.insert_attribute_after`
            )doc");
 
-  node.def("append_copy", py::overload_cast<const xml_attribute &>(&xml_node::append_copy), py::arg("proto"),
+  node.def("append_copy", py::overload_cast<const xml_attribute &>(&xml_node::append_copy), py::keep_alive<0, 1>(),
+           py::arg("proto"),
            "\tAdd a copy of attribute *proto* to the end of the list of attributes for this node.")
-      .def("append_copy", py::overload_cast<const xml_node &>(&xml_node::append_copy), py::arg("proto"),
+      .def("append_copy", py::overload_cast<const xml_node &>(&xml_node::append_copy), py::keep_alive<0, 1>(),
+           py::arg("proto"),
            "\tAdd a copy of node *proto* to the end of the list of children.\n\n"
            "Args:\n"
            "    proto (typing.Union[XMLAttribute, XMLNode]): The attribute or node to add after copying.\n\n"
@@ -1385,9 +4569,11 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "    >>> doc.print(pugi.PrintWriter())\n"
            "    <node attr1=\"1\" attr2=\"1\"/>");
 
-  node.def("prepend_copy", py::overload_cast<const xml_attribute &>(&xml_node::prepend_copy), py::arg("proto"),
+  node.def("prepend_copy", py::overload_cast<const xml_attribute &>(&xml_node::prepend_copy), py::keep_alive<0, 1>(),
+           py::arg("proto"),
            "\tAdd a copy of attribute *proto* to the top of the list of attributes for this node.")
-      .def("prepend_copy", py::overload_cast<const xml_node &>(&xml_node::prepend_copy), py::arg("proto"),
+      .def("prepend_copy", py::overload_cast<const xml_node &>(&xml_node::prepend_copy), py::keep_alive<0, 1>(),
+           py::arg("proto"),
            "\tAdd a copy of node *proto* to the top of the list of children.\n\n"
            "Args:\n"
            "    proto (typing.Union[XMLAttribute, XMLNode]): The attribute or node to add after copying.\n\n"
@@ -1399,10 +4585,10 @@ PYBIND11_MODULE(MODULE_NAME, m) {
 
   node.def("insert_copy_after",
            py::overload_cast<const xml_attribute &, const xml_attribute &>(&xml_node::insert_copy_after),
-           py::arg("proto"), py::arg("attr"),
+           py::keep_alive<0, 1>(), py::arg("proto"), py::arg("attr"),
            "\tInsert a copy of attribute *proto* after *attr* in the list of attributes for this node.")
       .def("insert_copy_after", py::overload_cast<const xml_node &, const xml_node &>(&xml_node::insert_copy_after),
-           py::arg("proto"), py::arg("node"),
+           py::keep_alive<0, 1>(), py::arg("proto"), py::arg("node"),
            "\tInsert a copy of node *proto* after *node* in the list of children.\n\n"
            "Args:\n"
            "    proto (typing.Union[XMLAttribute, XMLNode]): The attribute or node to insert after copying.\n\n"
@@ -1416,10 +4602,10 @@ PYBIND11_MODULE(MODULE_NAME, m) {
 
   node.def("insert_copy_before",
            py::overload_cast<const xml_attribute &, const xml_attribute &>(&xml_node::insert_copy_before),
-           py::arg("proto"), py::arg("attr"),
+           py::keep_alive<0, 1>(), py::arg("proto"), py::arg("attr"),
            "\tInsert a copy of attribute *proto* before *attr* in the list of attributes for this node.")
       .def("insert_copy_before", py::overload_cast<const xml_node &, const xml_node &>(&xml_node::insert_copy_before),
-           py::arg("proto"), py::arg("node"),
+           py::keep_alive<0, 1>(), py::arg("proto"), py::arg("node"),
            "\tInsert a copy of node *proto* before *node* in the list of children.\n\n"
            "Args:\n"
            "    proto (typing.Union[XMLAttribute, XMLNode]): The attribute or node to insert after copying.\n\n"
@@ -1431,10 +4617,11 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "See Also:\n"
            "    :meth:`.append_copy`, :meth:`.prepend_copy`, :meth:`.insert_copy_after`");
 
-  node.def("append_child", py::overload_cast<xml_node_type>(&xml_node::append_child),
+  node.def("append_child", py::overload_cast<xml_node_type>(&xml_node::append_child), py::keep_alive<0, 1>(),
            py::arg("node_type") = node_element,
            "\tAdd a new node with the specified node type to the end of the list of children.")
-      .def("append_child", py::overload_cast<const char_t *>(&xml_node::append_child), py::arg("name").none(false),
+      .def("append_child", py::overload_cast<const char_t *>(&xml_node::append_child), py::keep_alive<0, 1>(),
+           py::arg("name").none(false),
            "\tAdd a new node with the specified name to the end of the list of children.\n\n"
            "Args:\n"
            "    node_type (XMLNodeType): The node type to add.\n"
@@ -1444,10 +4631,121 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "See Also:\n"
            "    :meth:`.prepend_child`, :meth:`.insert_child_after`, :meth:`.insert_child_before`");
 
-  node.def("prepend_child", py::overload_cast<xml_node_type>(&xml_node::prepend_child),
+  node.def(
+      "append_element",
+      [](xml_node &self, const char_t *name, const py::object &attrs, const py::object &text, int precision) {
+        auto child = self.append_child(name);
+        if (!child) {
+          return child;
+        }
+        try {
+          if (!attrs.is_none()) {
+            append_object_attributes(child, attrs, precision);
+          }
+          if (!text.is_none()) {
+            auto child_text = child.text();
+            set_object_value(text, precision, [&](auto... args) { return child_text.set(args...); });
+          }
+        } catch (...) {
+          // Do not leave the partially built element in the tree.
+          self.remove_child(child);
+          throw;
+        }
+        return child;
+      },
+      py::keep_alive<0, 1>(), py::arg("name").none(false), py::arg("attrs") = py::none(),
+      py::arg("text") = py::none(), py::arg("precision") = default_double_precision,
+      R"doc(
+      (pugixml-python only) Add a new element with the attributes and the text to the end of the list of children.
+
+      The values of *attrs* and *text* are set with the same rules as :meth:`XMLAttribute.set_value` and
+      :meth:`XMLText.set`: :obj:`str`, :obj:`bool`, :obj:`int` and :obj:`float` are supported, and :obj:`float` is
+      formatted with *precision* significant digits.
+
+      Args:
+          name (str): The name of the element to add.
+          attrs (typing.Optional[typing.Mapping[str, typing.Union[str, bool, int, float]]]): The attribute names and
+              values of the element, in order.
+          text (typing.Union[str, bool, int, float, None]): The text of the element.
+          precision (int): The number of significant digits for :obj:`float` values.
+
+      Returns:
+          XMLNode: The element added, or empty node if error occurs.
+
+      Raises:
+          TypeError: If the attribute name or value, or the text, has an unsupported type; the element is not added.
+
+      See Also:
+          :meth:`.append_elements`, :meth:`.append_child`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> doc = pugi.XMLDocument()
+          >>> node = doc.append_child('node')
+          >>> child = node.append_element('item', {'id': 1, 'price': 9.5, 'stock': True}, 'foo')
+          >>> doc.print(pugi.PrintWriter(), flags=pugi.FORMAT_RAW)
+          <node><item id="1" price="9.5" stock="true">foo</item></node>
+      )doc");
+
+  node.def(
+      "append_elements",
+      [](xml_node &self, const char_t *name, const py::iterable &rows, int precision) {
+        size_t count = 0;
+        try {
+          for (const auto &row : rows) {
+            auto child = self.append_child(name);
+            if (!child) {
+              break;
+            }
+            ++count;
+            append_object_attributes(child, row, precision);
+          }
+        } catch (...) {
+          // Remove the elements added by this call, including the partially built one.
+          for (; count > 0; --count) {
+            self.remove_child(self.last_child());
+          }
+          throw;
+        }
+        return count;
+      },
+      py::arg("name").none(false), py::arg("rows"), py::arg("precision") = default_double_precision,
+      R"doc(
+      (pugixml-python only) Add new elements with the attributes to the end of the list of children.
+
+      An element named *name* is added for each mapping of *rows*, with the attributes set in the same way as
+      :meth:`.append_element`.
+
+      Args:
+          name (str): The name of the elements to add.
+          rows (typing.Iterable[typing.Mapping[str, typing.Union[str, bool, int, float]]]): The attribute names and
+              values of each element.
+          precision (int): The number of significant digits for :obj:`float` values.
+
+      Returns:
+          int: The number of elements added.
+
+      Raises:
+          TypeError: If the attribute name or value has an unsupported type; none of the elements are added.
+
+      See Also:
+          :meth:`.append_element`, :meth:`.append_child`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> doc = pugi.XMLDocument()
+          >>> node = doc.append_child('node')
+          >>> node.append_elements('row', [{'a': 1, 'b': 'x'}, {'a': 2, 'b': 'y'}])
+          2
+          >>> doc.print(pugi.PrintWriter(), flags=pugi.FORMAT_RAW)
+          <node><row a="1" b="x"/><row a="2" b="y"/></node>
+      )doc");
+
+  node.def("prepend_child", py::overload_cast<xml_node_type>(&xml_node::prepend_child), py::keep_alive<0, 1>(),
            py::arg("node_type") = node_element,
            "\tAdd a new node with the specified node type to the top of the list of children.")
-      .def("prepend_child", py::overload_cast<const char_t *>(&xml_node::prepend_child), py::arg("name").none(false),
+      .def("prepend_child", py::overload_cast<const char_t *>(&xml_node::prepend_child), py::keep_alive<0, 1>(),
+           py::arg("name").none(false),
            "\tAdd a new node with the specified name to the top of the list of children.\n\n"
            "Args:\n"
            "    node_type (XMLNodeType): The node type to add.\n"
@@ -1458,10 +4756,10 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "    :meth:`.append_child`, :meth:`.insert_child_after`, :meth:`.insert_child_before`");
 
   node.def("insert_child_after", py::overload_cast<xml_node_type, const xml_node &>(&xml_node::insert_child_after),
-           py::arg("node_type"), py::arg("node"),
+           py::keep_alive<0, 1>(), py::arg("node_type"), py::arg("node"),
            "\tInsert a new node with the specified node type after *node* in the list of children.")
       .def("insert_child_after", py::overload_cast<const char_t *, const xml_node &>(&xml_node::insert_child_after),
-           py::arg("name").none(false), py::arg("node"),
+           py::keep_alive<0, 1>(), py::arg("name").none(false), py::arg("node"),
            "\tInsert a new node with the specified name after *node* in the list of children.\n\n"
            "Args:\n"
            "    node_type (XMLNodeType): The node type to insert.\n"
@@ -1473,10 +4771,10 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "    :meth:`.append_child`, :meth:`.prepend_child`, :meth:`.insert_child_before`");
 
   node.def("insert_child_before", py::overload_cast<xml_node_type, const xml_node &>(&xml_node::insert_child_before),
-           py::arg("node_type"), py::arg("node"),
+           py::keep_alive<0, 1>(), py::arg("node_type"), py::arg("node"),
            "\tInsert a new node with the specified node type before *node* in the list of children.")
       .def("insert_child_before", py::overload_cast<const char_t *, const xml_node &>(&xml_node::insert_child_before),
-           py::arg("name").none(false), py::arg("node"),
+           py::keep_alive<0, 1>(), py::arg("name").none(false), py::arg("node"),
            "\tInsert a new node with the specified name before *node* in the list of children.\n\n"
            "Args:\n"
            "    node_type (XMLNodeType): The node type to insert.\n"
@@ -1487,7 +4785,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "See Also:\n"
            "    :meth:`.append_child`, :meth:`.prepend_child`, :meth:`.insert_child_after`");
 
-  node.def("append_move", &xml_node::append_move, py::arg("moved"),
+  node.def("append_move", &xml_node::append_move, py::keep_alive<0, 1>(), py::arg("moved"),
            R"doc(
            Move the specified node as the last child of this node.
 
@@ -1501,7 +4799,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.prepend_move`, :meth:`.insert_move_after`, :meth:`.insert_move_before`
            )doc");
 
-  node.def("prepend_move", &xml_node::prepend_move, py::arg("moved"),
+  node.def("prepend_move", &xml_node::prepend_move, py::keep_alive<0, 1>(), py::arg("moved"),
            R"doc(
            Move the specified node as the first child of this node.
 
@@ -1515,7 +4813,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.append_move`, :meth:`.insert_move_after`, :meth:`.insert_move_before`
            )doc");
 
-  node.def("insert_move_after", &xml_node::insert_move_after, py::arg("moved"), py::arg("node"),
+  node.def("insert_move_after", &xml_node::insert_move_after, py::keep_alive<0, 1>(), py::arg("moved"), py::arg("node"),
            R"doc(
            Move the specified node after *node* in the list of children.
 
@@ -1530,7 +4828,8 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.append_move`, :meth:`.prepend_move`, :meth:`.insert_move_before`
            )doc");
 
-  node.def("insert_move_before", &xml_node::insert_move_before, py::arg("moved"), py::arg("node"),
+  node.def("insert_move_before", &xml_node::insert_move_before, py::keep_alive<0, 1>(),
+           py::arg("moved"), py::arg("node"),
            R"doc(
            Move the specified node before *node* in the list of children.
 
@@ -1615,7 +4914,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
       [](const xml_node &self, const std::function<bool(const xml_attribute &)> &pred) {
         return self.find_attribute(pred);
       },
-      py::arg("pred"),
+      py::keep_alive<0, 1>(), py::arg("pred"),
       R"doc(
       Find the attribute using predicate.
 
@@ -1641,7 +4940,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   node.def(
       "find_child",
       [](const xml_node &self, const std::function<bool(const xml_node &)> &pred) { return self.find_child(pred); },
-      py::arg("pred"),
+      py::keep_alive<0, 1>(), py::arg("pred"),
       R"doc(
       Find the child node using predicate.
 
@@ -1667,7 +4966,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   node.def(
       "find_node",
       [](const xml_node &self, const std::function<bool(const xml_node &)> &pred) { return self.find_node(pred); },
-      py::arg("pred"),
+      py::keep_alive<0, 1>(), py::arg("pred"),
       R"doc(
       Find the node from subtree using predicate.
 
@@ -1693,11 +4992,12 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   node.def("find_child_by_attribute",
            py::overload_cast<const char_t *, const char_t *, const char_t *>(&xml_node::find_child_by_attribute,
                                                                              py::const_),
-           py::arg("name").none(false), py::arg("attr_name").none(false), py::arg("attr_value").none(false),
+           py::keep_alive<0, 1>(), py::arg("name").none(false), py::arg("attr_name").none(false),
+           py::arg("attr_value").none(false),
            "\tFind the child node with the specified node name, attribute name, and attribute value.")
       .def("find_child_by_attribute",
            py::overload_cast<const char_t *, const char_t *>(&xml_node::find_child_by_attribute, py::const_),
-           py::arg("attr_name").none(false), py::arg("attr_value").none(false),
+           py::keep_alive<0, 1>(), py::arg("attr_name").none(false), py::arg("attr_value").none(false),
            "\tFind the child node with the specified attribute name and attribute value.\n\n"
            "Args:\n"
            "    name (str): The node name to find.\n"
@@ -1720,8 +5020,8 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.first_element_by_path`
            )doc");
 
-  node.def("first_element_by_path", &xml_node::first_element_by_path, py::arg("path").none(false),
-           py::arg("delimiter").none(false) = '/',
+  node.def("first_element_by_path", &xml_node::first_element_by_path, py::keep_alive<0, 1>(),
+           py::arg("path").none(false), py::arg("delimiter").none(false) = '/',
            R"doc(
            Search for a node by path consisting of node names and '.' or '..' elements.
 
@@ -1736,8 +5036,20 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                :meth:`.path`
            )doc");
 
-  node.def("traverse", &xml_node::traverse, py::arg("walker"),
-           R"doc(
+  node.def(
+      "traverse",
+      [](xml_node &self, xml_tree_walker &walker) {
+        ScopedOperation operation(Operation::traverse);
+        auto py_walker = dynamic_cast<PyXMLTreeWalker *>(&walker);
+        const auto visited = py_walker ? py_walker->visited : 0;
+        const auto result = self.traverse(walker);
+        if (py_walker) {
+          operation.add_nodes(py_walker->visited - visited);
+        }
+        return result;
+      },
+      py::arg("walker"),
+      R"doc(
            Traverse subtree recursively with :class:`XMLTreeWalker`.
 
            First, ``traverse()`` calls :meth:`XMLTreeWalker.begin` with the traversal root as its arguments.
@@ -1772,84 +5084,193 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                <XMLNodeType.NODE_ELEMENT: 2> depth=1 name='child3'
            )doc");
 
-  node.def("select_node", py::overload_cast<const char_t *, xpath_variable_set *>(&xml_node::select_node, py::const_),
-           py::arg("query").none(false), py::arg("variables") = nullptr,
-           "\tSelect a single node by evaluating XPath expression with variables.\n\n"
-           "\tThis is equivalent to ``select_nodes(query, variables).first()``.")
-      .def("select_node", py::overload_cast<const xpath_query &>(&xml_node::select_node, py::const_), py::arg("query"),
-           "\tSelect a single node by evaluating XPath expression.\n\n"
-           "\tThis is equivalent to ``select_nodes(query).first()``.\n\n"
-           "Args:\n"
-           "    query (typing.Union[str, XPathQuery]): The XPath expression.\n"
-           "    variables (typing.Optional[XPathVariableSet]): The variables in *query*.\n\n"
-           "Returns:\n"
-           "    XPathNode: The first XPath node in the document order that matches the XPath expression, "
-           "    or empty XPath node if node is empty or XPath expression does not match anything.\n\n"
-           "See Also:\n"
-           "    :meth:`.select_nodes`, :class:`XPathNode`, :meth:`XPathQuery.evaluate_node`\n\n"
-           "Examples:\n"
-           "    >>> from pugixml import pugi\n"
-           "    >>> doc = pugi.XMLDocument()\n"
-           "    >>> doc.load_string('<node><head id=\"1\"/><foo id=\"2\"/><foo id=\"3\"/><tail id=\"4\"/></node>')\n"
-           "    >>> node = doc.select_node('//*[@id=\"2\"]')\n"
-           "    >>> bool(node)\n"
-           "    True\n"
-           "    >>> node.node().print(pugi.PrintWriter())\n"
-           "    <foo id=\"2\" />\n"
-           "    >>> varset = pugi.XPathVariableSet()\n"
-           "    >>> var = varset.add('id', pugi.XPATH_TYPE_NUMBER)\n"
-           "    >>> var.set(3)\n"
-           "    >>> node = doc.select_node('//*[@id=string($id)]', varset)\n"
-           "    >>> bool(node)\n"
-           "    True\n"
-           "    >>> node.node().print(pugi.PrintWriter())\n"
-           "    <foo id=\"3\" />\n"
-           "    >>> var.set(5)\n"
-           "    >>> node = doc.select_node('//*[@id=string($id)]', varset)\n"
-           "    >>> bool(node)\n"
-           "    False\n");
-
-  node.def("select_nodes", py::overload_cast<const char_t *, xpath_variable_set *>(&xml_node::select_nodes, py::const_),
-           py::arg("query").none(false), py::arg("variables") = nullptr,
-           "\tSelect the node set by evaluating XPath expression with variables.")
-      .def("select_nodes", py::overload_cast<const xpath_query &>(&xml_node::select_nodes, py::const_),
-           py::arg("query"),
-           "\tSelect the node set by evaluating XPath expression.\n\n"
-           "Args:\n"
-           "    query (typing.Union[str, XPathQuery]): The XPath expression.\n"
-           "    variables (typing.Optional[XPathVariableSet]): The variables in *query*.\n\n"
-           "Returns:\n"
-           "    XPathNodeSet: The XPath node set in the document order that matches the XPath expression, "
-           "    or empty XPath node set if node is empty or XPath expression does not match anything.\n\n"
-           "See Also:\n"
-           "    :meth:`.select_node`, :class:`XPathNodeSet`, :meth:`XPathQuery.evaluate_node_set`\n\n"
-           "Examples:\n"
-           "    >>> from pugixml import pugi\n"
-           "    >>> doc = pugi.XMLDocument()\n"
-           "    >>> doc.load_string('<node><head id=\"1\"/><foo id=\"2\"/><foo id=\"3\"/><tail id=\"4\"/></node>')\n"
-           "    >>> varset = pugi.XPathVariableSet()\n"
-           "    >>> var = varset.add('name', pugi.XPATH_TYPE_STRING)\n"
-           "    >>> query = pugi.XPathQuery('//*[local-name()=$name]', varset)\n"
-           "    >>> var.set('foo')\n"
-           "    >>> ns = doc.select_nodes(query)\n"
-           "    >>> ns.size()\n"
-           "    2\n"
-           "    >>> ns[0].node().print(pugi.PrintWriter())\n"
-           "    <foo id=\"2\" />\n"
-           "    >>> ns[1].node().print(pugi.PrintWriter())\n"
-           "    <foo id=\"3\" />\n"
-           "    >>> var.set('tail')\n"
-           "    >>> ns = doc.select_nodes(query)\n"
-           "    >>> ns.size()\n"
-           "    1\n"
-           "    >>> ns[0].node().print(pugi.PrintWriter())\n"
-           "    <tail id=\"4\" />\n");
+  node.def(
+          "select_node",
+          [](const xml_node &self, const char_t *query, xpath_variable_set *variables) {
+            const auto compiled = compile_xpath_query(query, variables);
+            ScopedOperation operation(Operation::select);
+            auto result = self.select_node(*compiled);
+            operation.add_nodes(result ? 1 : 0);
+            return result;
+          },
+          py::keep_alive<0, 1>(), py::arg("query").none(false), py::arg("variables") = nullptr,
+          "\tSelect a single node by evaluating XPath expression with variables.\n\n"
+          "\tThis is equivalent to ``select_nodes(query, variables).first()``.")
+      .def(
+          "select_node",
+          [](const xml_node &self, const xpath_query &query) {
+            ScopedOperation operation(Operation::select);
+            auto result = self.select_node(query);
+            operation.add_nodes(result ? 1 : 0);
+            return result;
+          },
+          py::keep_alive<0, 1>(), py::arg("query"),
+          "\tSelect a single node by evaluating XPath expression.\n\n"
+          "\tThis is equivalent to ``select_nodes(query).first()``.\n\n"
+          "Args:\n"
+          "    query (typing.Union[str, XPathQuery]): The XPath expression.\n"
+          "    variables (typing.Optional[XPathVariableSet]): The variables in *query*.\n\n"
+          "Returns:\n"
+          "    XPathNode: The first XPath node in the document order that matches the XPath expression, "
+          "    or empty XPath node if node is empty or XPath expression does not match anything.\n\n"
+          "See Also:\n"
+          "    :meth:`.select_nodes`, :class:`XPathNode`, :meth:`XPathQuery.evaluate_node`\n\n"
+          "Examples:\n"
+          "    >>> from pugixml import pugi\n"
+          "    >>> doc = pugi.XMLDocument()\n"
+          "    >>> doc.load_string('<node><head id=\"1\"/><foo id=\"2\"/><foo id=\"3\"/><tail id=\"4\"/></node>')\n"
+          "    >>> node = doc.select_node('//*[@id=\"2\"]')\n"
+          "    >>> bool(node)\n"
+          "    True\n"
+          "    >>> node.node().print(pugi.PrintWriter())\n"
+          "    <foo id=\"2\" />\n"
+          "    >>> varset = pugi.XPathVariableSet()\n"
+          "    >>> var = varset.add('id', pugi.XPATH_TYPE_NUMBER)\n"
+          "    >>> var.set(3)\n"
+          "    >>> node = doc.select_node('//*[@id=string($id)]', varset)\n"
+          "    >>> bool(node)\n"
+          "    True\n"
+          "    >>> node.node().print(pugi.PrintWriter())\n"
+          "    <foo id=\"3\" />\n"
+          "    >>> var.set(5)\n"
+          "    >>> node = doc.select_node('//*[@id=string($id)]', varset)\n"
+          "    >>> bool(node)\n"
+          "    False\n");
+
+  node.def(
+          "select_nodes",
+          [](const xml_node &self, const char_t *query, xpath_variable_set *variables) {
+            const auto compiled = compile_xpath_query(query, variables);
+            ScopedOperation operation(Operation::select);
+            auto result = self.select_nodes(*compiled);
+            operation.add_nodes(result.size());
+            return result;
+          },
+          py::keep_alive<0, 1>(), py::arg("query").none(false), py::arg("variables") = nullptr,
+          "\tSelect the node set by evaluating XPath expression with variables.")
+      .def(
+          "select_nodes",
+          [](const xml_node &self, const xpath_query &query) {
+            ScopedOperation operation(Operation::select);
+            auto result = self.select_nodes(query);
+            operation.add_nodes(result.size());
+            return result;
+          },
+          py::keep_alive<0, 1>(), py::arg("query"),
+          "\tSelect the node set by evaluating XPath expression.\n\n"
+          "Args:\n"
+          "    query (typing.Union[str, XPathQuery]): The XPath expression.\n"
+          "    variables (typing.Optional[XPathVariableSet]): The variables in *query*.\n\n"
+          "Returns:\n"
+          "    XPathNodeSet: The XPath node set in the document order that matches the XPath expression, "
+          "    or empty XPath node set if node is empty or XPath expression does not match anything.\n\n"
+          "See Also:\n"
+          "    :meth:`.select_node`, :class:`XPathNodeSet`, :meth:`XPathQuery.evaluate_node_set`\n\n"
+          "Examples:\n"
+          "    >>> from pugixml import pugi\n"
+          "    >>> doc = pugi.XMLDocument()\n"
+          "    >>> doc.load_string('<node><head id=\"1\"/><foo id=\"2\"/><foo id=\"3\"/><tail id=\"4\"/></node>')\n"
+          "    >>> varset = pugi.XPathVariableSet()\n"
+          "    >>> var = varset.add('name', pugi.XPATH_TYPE_STRING)\n"
+          "    >>> query = pugi.XPathQuery('//*[local-name()=$name]', varset)\n"
+          "    >>> var.set('foo')\n"
+          "    >>> ns = doc.select_nodes(query)\n"
+          "    >>> ns.size()\n"
+          "    2\n"
+          "    >>> ns[0].node().print(pugi.PrintWriter())\n"
+          "    <foo id=\"2\" />\n"
+          "    >>> ns[1].node().print(pugi.PrintWriter())\n"
+          "    <foo id=\"3\" />\n"
+          "    >>> var.set('tail')\n"
+          "    >>> ns = doc.select_nodes(query)\n"
+          "    >>> ns.size()\n"
+          "    1\n"
+          "    >>> ns[0].node().print(pugi.PrintWriter())\n"
+          "    <tail id=\"4\" />\n");
+
+  node.def(
+      "extract_columns",
+      [](const xml_node &self, const char_t *record, const py::dict &fields, const py::dict &types) {
+        std::vector<Column> columns;
+        columns.reserve(fields.size());
+        for (const auto &item : fields) {
+          auto type = std::string("string");
+          if (types.contains(item.first)) {
+            type = types[item.first].cast<std::string>();
+          }
+          if (!_column_type_to_typecode.count(type)) {
+            throw py::value_error("unsupported column type: " + type);
+          }
+          const auto query = item.second.cast<string_t>();
+          auto &column = columns.emplace_back(item.first, query.c_str(), _column_type_to_typecode[type]);
+          if (!*column.query_) {
+            throw py::value_error(std::string(column.query_->result().description()) + ": " +
+                                  to_utf8(query.c_str()));
+          }
+        }
+
+        for (const auto &child : self.children(record)) {
+          for (auto &column : columns) {
+            column.extract(child);
+          }
+        }
+
+        py::dict result;
+        const auto array = py::module_::import("array").attr("array");
+        for (const auto &column : columns) {
+          result[column.name_] = column.result(array);
+        }
+        return result;
+      },
+      py::arg("record").none(false), py::arg("fields"), py::arg("types") = py::dict(),
+      R"doc(
+      Extract the values of the repeated child elements into columns.
+
+      For each child element named *record*, every XPath expression of *fields* is evaluated with the child element as
+      the context node. If the expression selects a node set, the value of the first attribute or the text of the first
+      node is converted with the same rules as :meth:`XMLAttribute.as_int`, :meth:`XMLText.as_double`, etc.;
+      otherwise the result of the expression is converted.
+
+      Args:
+          record (str): The name of the child elements to extract.
+          fields (typing.Dict[str, str]): The column names and the XPath expressions to evaluate.
+          types (typing.Dict[str, str]): The column names and the column types.
+              The column type is one of ``'string'`` (default), ``'bool'``, ``'int'``, ``'uint'``, ``'llong'``,
+              ``'ullong'``, ``'float'`` or ``'double'``.
+
+      Returns:
+          typing.Dict[str, typing.Union[typing.List[str], array.array]]: The columns in the order of *fields*.
+          The ``'string'`` columns are lists of :obj:`str`, and the other columns are :obj:`array.array`
+          with the typecode ``'B'``, ``'i'``, ``'I'``, ``'q'``, ``'Q'``, ``'f'`` or ``'d'`` respectively.
+
+      Raises:
+          ValueError: If the column type is not supported or the XPath expression is invalid.
+
+      See Also:
+          :meth:`.children`, :class:`XPathQuery`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_string('<rows><row a="1"><c>x</c></row><row a="2"><c>y</c></row></rows>')
+          >>> columns = doc.child('rows').extract_columns('row', {'a': '@a', 'c': 'c/text()'}, {'a': 'int'})
+          >>> columns['a']
+          array('i', [1, 2])
+          >>> columns['c']
+          ['x', 'y']
+      )doc");
 
   options.disable_function_signatures();
-  node.def("print",
-           py::overload_cast<xml_writer &, const char_t *, unsigned int, xml_encoding, unsigned int>(&xml_node::print,
-                                                                                                     py::const_),
-           py::arg("writer"), py::arg("indent").none(false) = PUGIXML_TEXT("\t"),
+  node.def(
+      "print",
+      [](const xml_node &self, xml_writer &writer, const char_t *indent, unsigned int flags, xml_encoding encoding,
+         unsigned int depth) {
+        ScopedOperation operation(Operation::save);
+        CountingWriter counter(writer);
+        self.print(counter, indent, flags, encoding, depth);
+        operation.add_bytes(counter.bytes());
+      },
+      py::arg("writer"), py::arg("indent").none(false) = PUGIXML_TEXT("\t"),
            py::arg_v("flags", format_default, "pugixml.pugi.FORMAT_DEFAULT"), py::arg("encoding") = encoding_auto,
            py::arg("depth") = 0,
            R"doc(
@@ -1893,6 +5314,63 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            )doc");
   options.enable_function_signatures();
 
+  options.disable_function_signatures();
+  node.def(
+      "print_parallel",
+      [](const xml_node &self, xml_writer &writer, const char_t *indent, unsigned int flags, xml_encoding encoding,
+         unsigned int depth, size_t threads) {
+        ScopedOperation operation(Operation::save);
+        ParallelPrinter printer(indent, flags, encoding, threads > 0 ? threads : std::thread::hardware_concurrency());
+        CountingWriter counter(writer);
+        {
+          py::gil_scoped_release release;
+          printer.print(self, depth, counter, is_native_writer(writer));
+        }
+        operation.add_bytes(counter.bytes());
+      },
+      py::arg("writer"), py::arg("indent").none(false) = PUGIXML_TEXT("\t"),
+      py::arg_v("flags", format_default, "pugixml.pugi.FORMAT_DEFAULT"), py::arg("encoding") = encoding_auto,
+      py::arg("depth") = 0, py::arg("threads") = 0,
+      R"doc(
+      print_parallel(self: pugixml.pugi.XMLNode, writer: pugixml.pugi.XMLWriter, indent: str = '\t', flags: int = pugixml.pugi.FORMAT_DEFAULT, encoding: pugixml.pugi.XMLEncoding = pugixml.pugi.ENCODING_AUTO, depth: int = 0, threads: int = 0) -> None
+
+      (pugixml-python only) Save a single subtree to *writer*, serializing it in parallel.
+
+      The output is the same as :meth:`.print` with the same arguments. The children of the first element that has
+      more than one child (e.g. the records in ``<root><record/><record/>...</root>``) are divided into *threads*
+      runs, which are serialized into separate buffers by the threads with the GIL released, and each buffer is
+      written to *writer* in order as soon as it and the ones before it are finished. The subtree is serialized by
+      one thread if there are no such children.
+
+      :class:`BytesWriter` and :class:`FileWriter` are written with the GIL released; the GIL is acquired for each
+      write to the other writers.
+
+      Note:
+          The threads serialize at most twice as many runs as there are threads ahead of the writer, so the output
+          is not held in memory as a whole. Do not modify the document or use *writer* from other threads while it
+          is serialized.
+
+      Args:
+          writer (XMLWriter): The writer object which implements :class:`XMLWriter` interface.
+          indent (str): The indentation character(s).
+          flags (int): The :pugixml:`output options <manual.html#saving.options>`.
+          encoding (XMLEncoding): The :pugixml:`output encoding <manual.html#saving.encoding>`.
+          depth (int): The number of node's depth.
+          threads (int): The number of threads, or 0 to use the number of CPUs.
+
+      See Also:
+          :meth:`.print`, :meth:`XMLDocument.load_file_parallel`
+
+      Examples:
+          >>> from contextlib import closing
+          >>> from pugixml import pugi
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_file_parallel('export.xml', 'record')
+          >>> with closing(pugi.FileWriter('copy.xml')) as writer:
+          ...     doc.print_parallel(writer, threads=8)
+      )doc");
+  options.enable_function_signatures();
+
   // xml_node::begin()
   // xml_node::end()
   // xml_node::attributes_begin()
@@ -1995,16 +5473,17 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                bool: :obj:`True` if object is empty, :obj:`False` otherwise.
            )doc");
 
-  text.def("get", &xml_text::get,
-           R"doc(
-           Return the contents.
+  text.def(
+      "get", [](const xml_text &self) { return to_str(self.get()); },
+      R"doc(
+      Return the contents.
 
-           Returns:
-               str: The contents, or the empty string if object is empty.
+      Returns:
+          str: The contents, or the empty string if object is empty.
 
-           See Also:
-               :meth:`.as_string`
-           )doc");
+      See Also:
+          :meth:`.as_string`
+      )doc");
 
   text.def("as_string", &xml_text::as_string, py::arg("default").none(false) = PUGIXML_TEXT(""),
            R"doc(
@@ -2116,7 +5595,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
            "Returns:\n"
            "    bool: :obj:`False` if object is empty or there is not enough memory.");
 
-  text.def("data", &xml_text::data,
+  text.def("data", &xml_text::data, py::keep_alive<0, 1>(),
            R"doc(
            Return the data node (:attr:`NODE_PCDATA` or :attr:`NODE_CDATA`) for this object.
 
@@ -2247,16 +5726,39 @@ PYBIND11_MODULE(MODULE_NAME, m) {
     return ss.str();
   });
 
-  xdoc.def("reset", py::overload_cast<>(&xml_document::reset), "\tRemove all nodes.")
-      .def("reset", py::overload_cast<const xml_document &>(&xml_document::reset), py::arg("proto"),
+  xdoc.def(
+      "reset",
+      [](xml_document &self, bool keep_memory) {
+        _retain_memory = keep_memory;
+        self.reset();
+        _retain_memory = false;
+      },
+      py::arg("keep_memory") = false,
+      "\tRemove all nodes.\n\n"
+      "Args:\n"
+      "    keep_memory (bool): (pugixml-python only) If :obj:`True`, the memory pages of the document are\n"
+      "        retained (up to 64 MiB in total) and reused by the next allocations, e.g., the next parsing.\n"
+      "        See :func:`pugixml.pugi.memory.trim` to release them.");
+  xdoc.def("reset", py::overload_cast<const xml_document &>(&xml_document::reset), py::arg("proto"),
            "\tRemove all nodes, then copies the entire contents of the specified document.\n\n"
            "Args:\n"
            "    proto (XMLDocument): The XML document to copy.");
 
   options.disable_function_signatures();
-  xdoc.def("load_string", &xml_document::load_string, py::arg("contents").none(false),
-           py::arg("options") = parse_default,
-           R"doc(
+  xdoc.def(
+      "load_string",
+      [](xml_document &self, const char_t *contents, unsigned int options) {
+        ScopedOperation operation(Operation::load);
+        const auto length = std::char_traits<char_t>::length(contents);
+        operation.add_bytes(length * sizeof(char_t));
+        if (const auto result = load_fast_scan(self, reinterpret_cast<const char *>(contents), length * sizeof(char_t),
+                                               options, encoding_auto)) {
+          return *result;
+        }
+        return self.load_string(contents, options);
+      },
+      py::arg("contents").none(false), py::arg("options") = parse_default,
+      R"doc(
            load_string(self: pugixml.pugi.XMLDocument, contents: str, options: int = pugixml.pugi.PARSE_DEFAULT) -> pugixml.pugi.XMLParseResult
 
            Load a document from a string.
@@ -2282,29 +5784,50 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   options.disable_function_signatures();
   xdoc.def(
       "load_file",
-      [](xml_document &self, const fs::path &path, unsigned int options, xml_encoding encoding) {
-        return self.load_file(path.string<char>().c_str(), options, encoding);
+      [](xml_document &self, const fs::path &path, unsigned int options, xml_encoding encoding,
+         const std::optional<fs::path> &cache_dir, const std::optional<std::string> &compression) {
+        const auto codec = get_compression(compression, path, true);
+        py::gil_scoped_release release;
+        return load_document_file(self, path, options, encoding, cache_dir, codec);
       },
       py::arg("path"), py::arg("options") = parse_default, py::arg("encoding") = encoding_auto,
+      py::arg("cache_dir") = py::none(), py::arg("compression") = py::none(),
       R"doc(
-      load_file(self: pugixml.pugi.XMLDocument, path: os.PathLike, options: int = pugixml.pugi.PARSE_DEFAULT, encoding: pugixml.pugi.XMLEncoding = pugixml.pugi.ENCODING_AUTO) -> pugixml.pugi.XMLParseResult
+      load_file(self: pugixml.pugi.XMLDocument, path: os.PathLike, options: int = pugixml.pugi.PARSE_DEFAULT, encoding: pugixml.pugi.XMLEncoding = pugixml.pugi.ENCODING_AUTO, cache_dir: typing.Optional[os.PathLike] = None, compression: typing.Optional[str] = None) -> pugixml.pugi.XMLParseResult
 
       Load a document from the existing file.
 
       The existing document tree is destroyed.
 
+      If *cache_dir* is specified, the document tree is loaded from the binary snapshot (see
+      :meth:`.save_snapshot`) cached in *cache_dir* instead of parsing the file. The cache is valid while the size and
+      the modification time of the file, *options* and *encoding* are unchanged. Otherwise, the file is parsed and the
+      cache is updated.
+
+      A file compressed with gzip or zstd is decompressed directly into the parse buffer. The file is loaded with the
+      GIL released.
+
       Args:
           path (os.PathLike): The path-like object of the document to parse.
           options (int): The :pugixml:`parsing options <manual.html#loading.options>`.
           encoding (XMLEncoding): The :pugixml:`input encoding <manual.html#loading.encoding>`.
+          cache_dir (typing.Optional[os.PathLike]): (pugixml-python only) The path-like object of the directory
+              to cache the parsed document.
+          compression (typing.Optional[str]): (pugixml-python only) The compression of the file: ``'gzip'``,
+              ``'zstd'`` or ``'none'``, or :obj:`None` to detect it from the contents of the file.
 
       Returns:
           XMLParseResult: The result of the operation.
 
+      Raises:
+          ValueError: If the compression is not supported (see :data:`BUILD_OPTIONS`).
+
       Examples:
           >>> from pugixml import pugi
           >>> doc = pugi.XMLDocument()
           >>> doc.load_file('tree.xml', pugi.PARSE_DEFAULT | pugi.PARSE_DECLARATION | pugi.PARSE_COMMENTS)
+          >>> doc.load_file('config.xml', cache_dir='.cache')
+          >>> doc.load_file('export.xml.zst')
       )doc");
   options.enable_function_signatures();
 
@@ -2312,6 +5835,11 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   xdoc.def(
       "load_buffer",
       [](xml_document &self, const char *contents, size_t size, unsigned int options, xml_encoding encoding) {
+        ScopedOperation operation(Operation::load);
+        operation.add_bytes(size);
+        if (const auto result = load_fast_scan(self, contents, size, options, encoding)) {
+          return *result;
+        }
         return self.load_buffer(contents, size, options, encoding);
       },
       py::arg("contents"), py::arg("size"), py::arg("options") = parse_default, py::arg("encoding") = encoding_auto,
@@ -2342,9 +5870,16 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   options.enable_function_signatures();
 
   options.disable_function_signatures();
-  xdoc.def("save",
-           py::overload_cast<xml_writer &, const char_t *, unsigned int, xml_encoding>(&xml_document::save, py::const_),
-           py::arg("writer"), py::arg("indent").none(false) = PUGIXML_TEXT("\t"),
+  xdoc.def(
+      "save",
+      [](const xml_document &self, xml_writer &writer, const char_t *indent, unsigned int flags,
+         xml_encoding encoding) {
+        ScopedOperation operation(Operation::save);
+        CountingWriter counter(writer);
+        self.save(counter, indent, flags, encoding);
+        operation.add_bytes(counter.bytes());
+      },
+      py::arg("writer"), py::arg("indent").none(false) = PUGIXML_TEXT("\t"),
            py::arg_v("flags", format_default, "pugixml.pugi.FORMAT_DEFAULT"), py::arg("encoding") = encoding_auto,
            R"doc(
            save(self: pugixml.pugi.XMLDocument, writer: pugixml.pugi.XMLWriter, indent: str = '\t', flags: int = pugixml.pugi.FORMAT_DEFAULT, encoding: pugixml.pugi.XMLEncoding = pugixml.pugi.ENCODING_AUTO) -> None
@@ -2360,60 +5895,534 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                flags (int): The :pugixml:`output options <manual.html#saving.options>`.
                encoding (XMLEncoding): The :pugixml:`output encoding <manual.html#saving.encoding>`.
 
-           See Also:
-               :meth:`XMLNode.print`, :class:`XMLWriter`
+           See Also:
+               :meth:`XMLNode.print`, :class:`XMLWriter`
+
+           Examples:
+               A simple example of saving an XML document to a file:
+
+               >>> from pugixml import pugi
+               >>> class FileWriter(pugi.XMLWriter):
+               ...     def __init__(self, path) -> None:
+               ...         super().__init__()
+               ...         self._file = open(path, 'wb')
+               ...     def close(self) -> None:
+               ...         self._file.close()
+               ...     def write(self, data: bytes, size: int) -> None:
+               ...         self._file.write(data)
+
+               >>> from contextlib import closing
+               >>> doc = pugi.XMLDocument()
+               >>> doc.append_child('node')
+               >>> with closing(FileWriter('tree.xml')) as writer:
+               ...     doc.save(writer)
+           )doc");
+  options.enable_function_signatures();
+
+  options.disable_function_signatures();
+  xdoc.def(
+      "save_file",
+      [](const xml_document &self, const fs::path &path, const char_t *indent, unsigned int flags,
+         xml_encoding encoding, const std::optional<std::string> &compression) {
+        const auto codec = get_compression(compression, path, false);
+        py::gil_scoped_release release;
+        return save_document_file(self, path, indent, flags, encoding, codec);
+      },
+      py::arg("path"), py::arg("indent").none(false) = PUGIXML_TEXT("\t"),
+      py::arg_v("flags", format_default, "pugixml.pugi.FORMAT_DEFAULT"), py::arg("encoding") = encoding_auto,
+      py::arg("compression") = py::none(),
+      R"doc(
+      save_file(self: pugixml.pugi.XMLDocument, path: os.PathLike, indent: str = '\t', flags: int = pugixml.pugi.FORMAT_DEFAULT, encoding: pugixml.pugi.XMLEncoding = pugixml.pugi.ENCODING_AUTO, compression: typing.Optional[str] = None) -> bool
+
+      Save the XML document to a file.
+
+      With gzip or zstd compression, the output is compressed directly from the writer to the file. The file is saved
+      with the GIL released.
+
+      Args:
+          path (os.PathLike): The path-like object to save the XML document.
+          indent (str): The indentation character(s).
+          flags (int): The :pugixml:`output options <manual.html#saving.options>`.
+          encoding (XMLEncoding): The :pugixml:`output encoding <manual.html#saving.encoding>`.
+          compression (typing.Optional[str]): (pugixml-python only) The compression of the file: ``'gzip'``,
+              ``'zstd'`` or ``'none'``, or :obj:`None` to select it from the suffix of *path* (``.gz`` or ``.zst``).
+
+      Returns:
+          bool: :obj:`True` if the saving was successful, :obj:`False` otherwise.
+
+      Raises:
+          ValueError: If the compression is not supported (see :data:`BUILD_OPTIONS`).
+      )doc");
+  options.enable_function_signatures();
+
+  options.disable_function_signatures();
+  xdoc.def(
+      "load_file_async",
+      [](py::object self, const fs::path &path, unsigned int options, xml_encoding encoding,
+         const std::optional<fs::path> &cache_dir, const std::optional<std::string> &compression) {
+        return run_in_executor(py::cpp_function([self, doc = &self.cast<xml_document &>(), path, options, encoding,
+                                                 cache_dir, compression]() {
+          const auto codec = get_compression(compression, path, true);
+          py::gil_scoped_release release;
+          return load_document_file(*doc, path, options, encoding, cache_dir, codec);
+        }));
+      },
+      py::arg("path"), py::arg("options") = parse_default, py::arg("encoding") = encoding_auto,
+      py::arg("cache_dir") = py::none(), py::arg("compression") = py::none(),
+      R"doc(
+      load_file_async(self: pugixml.pugi.XMLDocument, path: os.PathLike, options: int = pugixml.pugi.PARSE_DEFAULT, encoding: pugixml.pugi.XMLEncoding = pugixml.pugi.ENCODING_AUTO, cache_dir: typing.Optional[os.PathLike] = None, compression: typing.Optional[str] = None) -> asyncio.Future[pugixml.pugi.XMLParseResult]
+
+      (pugixml-python only) Load a document from the existing file in a worker thread.
+
+      The file is read and parsed in the default executor of the running event loop with the GIL released; the
+      returned future is resolved with the result when the document is loaded. The existing document tree is
+      destroyed.
+
+      Note:
+          Do not access or modify the document until the future is done.
+
+      Args:
+          path (os.PathLike): The path-like object of the document to parse.
+          options (int): The :pugixml:`parsing options <manual.html#loading.options>`.
+          encoding (XMLEncoding): The :pugixml:`input encoding <manual.html#loading.encoding>`.
+          cache_dir (typing.Optional[os.PathLike]): The path-like object of the directory to cache the parsed
+              document (see :meth:`.load_file`).
+          compression (typing.Optional[str]): The compression of the file (see :meth:`.load_file`).
+
+      Returns:
+          asyncio.Future[XMLParseResult]: The future of the result of the operation.
+
+      Raises:
+          RuntimeError: If there is no running event loop.
+          ValueError: If the compression is not supported.
+
+      See Also:
+          :meth:`.load_file`, :class:`XMLFeedParser`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> async def load(path):
+          ...     doc = pugi.XMLDocument()
+          ...     result = await doc.load_file_async(path)
+          ...     return doc if result else None
+      )doc");
+  options.enable_function_signatures();
+
+  options.disable_function_signatures();
+  xdoc.def(
+      "load_file_parallel",
+      [](xml_document &self, const fs::path &path, const char_t *split_tag, size_t threads, unsigned int options,
+         xml_encoding encoding, const std::optional<std::string> &compression) {
+        const auto codec = get_compression(compression, path, true);
+        const auto tag = to_utf8(split_tag);
+        py::gil_scoped_release release;
+        return load_file_parallel(self, path, tag, threads, options, encoding, codec);
+      },
+      py::arg("path"), py::arg("split_tag").none(false), py::arg("threads") = 0, py::arg("options") = parse_default,
+      py::arg("encoding") = encoding_auto, py::arg("compression") = py::none(),
+      R"doc(
+      load_file_parallel(self: pugixml.pugi.XMLDocument, path: os.PathLike, split_tag: str, threads: int = 0, options: int = pugixml.pugi.PARSE_DEFAULT, encoding: pugixml.pugi.XMLEncoding = pugixml.pugi.ENCODING_AUTO, compression: typing.Optional[str] = None) -> pugixml.pugi.XMLParseResult
+
+      (pugixml-python only) Load a document of many records from the existing file in parallel.
+
+      The records are the sibling elements named *split_tag*, e.g. ``<record>`` in
+      ``<root><record/><record/>...</root>``. The file is split into runs of records at the start tags of the records,
+      and the runs are parsed as fragments in *threads* threads with the GIL released. The parsed records are then
+      copied in order under their parent, so the resulting document tree is the same as :meth:`.load_file`. The
+      existing document tree is destroyed.
+
+      The file is parsed serially if it cannot be split safely: the encoding of the file is not UTF-8, a split point
+      is in a comment, CDATA or a nested record, the records are not siblings, or
+      :data:`PARSE_WS_PCDATA_SINGLE` is set. The records are copied into the document by one thread, and the
+      copying limits the speedup; use :func:`load_file_fragments` to get the parsed runs without copying them.
+
+      Args:
+          path (os.PathLike): The path-like object of the document to parse.
+          split_tag (str): The name of the records.
+          threads (int): The number of threads, or 0 to use the number of CPUs.
+          options (int): The :pugixml:`parsing options <manual.html#loading.options>`.
+          encoding (XMLEncoding): The :pugixml:`input encoding <manual.html#loading.encoding>`.
+          compression (typing.Optional[str]): The compression of the file (see :meth:`.load_file`).
+
+      Returns:
+          XMLParseResult: The result of the operation.
+
+      Raises:
+          ValueError: If the compression is not supported.
+
+      See Also:
+          :meth:`.load_file`, :func:`load_file_fragments`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_file_parallel('export.xml', 'record', threads=8)
+      )doc");
+  options.enable_function_signatures();
+
+  options.disable_function_signatures();
+  xdoc.def(
+      "save_file_async",
+      [](py::object self, const fs::path &path, const char_t *indent, unsigned int flags, xml_encoding encoding,
+         const std::optional<std::string> &compression) {
+        const auto codec = get_compression(compression, path, false);
+        return run_in_executor(py::cpp_function([self, doc = &self.cast<const xml_document &>(), path,
+                                                 indent = string_t(indent), flags, encoding, codec]() {
+          py::gil_scoped_release release;
+          return save_document_file(*doc, path, indent.c_str(), flags, encoding, codec);
+        }));
+      },
+      py::arg("path"), py::arg("indent").none(false) = PUGIXML_TEXT("\t"),
+      py::arg_v("flags", format_default, "pugixml.pugi.FORMAT_DEFAULT"), py::arg("encoding") = encoding_auto,
+      py::arg("compression") = py::none(),
+      R"doc(
+      save_file_async(self: pugixml.pugi.XMLDocument, path: os.PathLike, indent: str = '\t', flags: int = pugixml.pugi.FORMAT_DEFAULT, encoding: pugixml.pugi.XMLEncoding = pugixml.pugi.ENCODING_AUTO, compression: typing.Optional[str] = None) -> asyncio.Future[bool]
+
+      (pugixml-python only) Save the XML document to a file in a worker thread.
+
+      The document is serialized and written in the default executor of the running event loop with the GIL
+      released; the returned future is resolved with the result when the file is saved.
+
+      Note:
+          Do not modify the document until the future is done.
+
+      Args:
+          path (os.PathLike): The path-like object to save the XML document.
+          indent (str): The indentation character(s).
+          flags (int): The :pugixml:`output options <manual.html#saving.options>`.
+          encoding (XMLEncoding): The :pugixml:`output encoding <manual.html#saving.encoding>`.
+          compression (typing.Optional[str]): The compression of the file (see :meth:`.save_file`).
+
+      Returns:
+          asyncio.Future[bool]: The future of :obj:`True` if the saving was successful, :obj:`False` otherwise.
+
+      Raises:
+          RuntimeError: If there is no running event loop.
+          ValueError: If the compression is not supported.
+
+      See Also:
+          :meth:`.save_file`
+      )doc");
+  options.enable_function_signatures();
+
+  xdoc.def("document_element", &xml_document::document_element, py::keep_alive<0, 1>(),
+           R"doc(
+           Return the document element.
+
+           Returns:
+               XMLNode: The element whose parent is this document, or empty node if not exists.
+           )doc");
+
+  xdoc.def(
+      "compact",
+      [](xml_document &self) {
+        // The new pages are allocated and the old ones are released by this thread, so the thread counters give the
+        // change of the memory of this document regardless of the allocations of other threads.
+        const auto allocated_bytes = _thread_allocated_bytes;
+        const auto deallocated_bytes = _thread_deallocated_bytes;
+        {
+          xml_document compacted;
+          compacted.reset(self);
+          self = std::move(compacted);
+        }
+        const auto allocated = _thread_allocated_bytes - allocated_bytes;
+        const auto released = _thread_deallocated_bytes - deallocated_bytes;
+        return released > allocated ? released - allocated : 0;
+      },
+      R"doc(
+      (pugixml-python only) Rebuild the document tree into new, tightly packed memory pages.
+
+      The memory of the removed nodes and attributes is kept in the pages until all objects in the page are removed;
+      this method copies the tree and releases the old pages and the parsing buffer.
+
+      Note:
+          All :class:`XMLNode`, :class:`XMLAttribute`, :class:`XMLText` and :class:`XPathNode` objects obtained from
+          this document are invalidated; get them again from the document after compaction.
+
+      Returns:
+          int: The number of bytes reclaimed, i.e. the size of the memory blocks of the document released by the
+          compaction minus the size of the new ones.
+
+      See Also:
+          :meth:`.memory_usage`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_string('<node>' + '<child/>' * 10000 + '</node>')
+          >>> doc.child('node').remove_children()
+          True
+          >>> doc.compact() > 0
+          True
+      )doc");
+
+  xdoc.def(
+      "memory_usage",
+      [](const xml_document &self) {
+        MemoryUsage usage;
+        usage.add_tree(self);
+        return usage.result();
+      },
+      R"doc(
+      (pugixml-python only) Return the memory usage of the document tree.
+
+      The sizes of the node and attribute structures are estimated from their layouts, and the size of the memory
+      pages is the total size of the memory blocks referenced by the tree (the pages allocated by pugixml, the
+      parsing buffer for the in-place strings, and the large strings).
+
+      Note:
+          The page figures need the registry of the memory blocks, which is disabled by default: ``blocks``,
+          ``page_bytes`` and ``wasted_bytes`` count only the blocks allocated while
+          :func:`pugixml.pugi.memory.set_block_tracking` is enabled, and are 0 for a document loaded while it is
+          disabled. ``nodes``, ``attributes``, ``struct_bytes`` and ``string_bytes`` are always available.
+
+      Returns:
+          typing.Dict[str, int]: The memory usage:
+
+          - ``nodes``: The number of nodes, excluding the document node.
+          - ``attributes``: The number of attributes.
+          - ``struct_bytes``: The size of the node and attribute structures, in bytes.
+          - ``string_bytes``: The size of the names and values, including the terminating null characters, in bytes.
+          - ``blocks``: The number of memory blocks referenced by the tree (0 without the block tracking).
+          - ``page_bytes``: The size of the memory blocks referenced by the tree, in bytes (0 without the block
+            tracking).
+          - ``wasted_bytes``: The size of the memory blocks not used for the structures and the strings, in bytes;
+            e.g., the freed nodes and strings, the unused space of the pages, and the markup in the parsing buffer.
+
+      See Also:
+          :func:`pugixml.pugi.memory.stats`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> pugi.memory.set_block_tracking(True)
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_string('<node attr="value"><child/></node>')
+          >>> usage = doc.memory_usage()
+          >>> usage['nodes'], usage['attributes']
+          (2, 1)
+          >>> usage['page_bytes'] > 0
+          True
+      )doc");
+
+  xdoc.def(
+      "save_snapshot", [](const xml_document &self) { return save_snapshot(self); },
+      R"doc(
+      (pugixml-python only) Save the document tree as a binary snapshot.
+
+      The snapshot contains the nodes and attributes of the document tree with a pool of deduplicated strings,
+      and can be loaded by :meth:`.load_snapshot`. Loading the snapshot rebuilds the tree node by node and copies
+      every string, so it is not necessarily faster than parsing the XML document.
+      The snapshot is not portable between platforms with different byte orders.
+
+      Returns:
+          bytes: The binary snapshot of the document tree.
+
+      See Also:
+          :meth:`.load_snapshot`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_string('<node><child/></node>')
+          >>> data = doc.save_snapshot()
+          >>> doc2 = pugi.XMLDocument()
+          >>> doc2.load_snapshot(data)
+          >>> doc2.print(pugi.PrintWriter(), flags=pugi.FORMAT_RAW)
+          <node><child/></node>
+      )doc");
+
+  xdoc.def(
+      "load_snapshot",
+      [](xml_document &self, const py::buffer &data) {
+        const ContiguousBuffer buffer(data);
+        py::gil_scoped_release release;
+        load_snapshot(self, buffer.data(), buffer.size());
+      },
+      py::arg("data"),
+      R"doc(
+      (pugixml-python only) Load the document tree from a binary snapshot.
+
+      The existing document tree is destroyed.
+
+      *data* can be any C-contiguous object that supports the buffer protocol, such as :obj:`bytes`,
+      :obj:`memoryview`, :obj:`mmap.mmap` or :attr:`multiprocessing.shared_memory.SharedMemory.buf`.
+      The snapshot is read in place without copying, and any data after the snapshot is ignored.
+      The GIL is released while the document tree is built.
+
+      Note:
+          The nodes of pugixml are linked by pointers, so the document tree is not shared: each process that loads
+          the snapshot builds its own copy of the tree in its own memory, and only the snapshot bytes can be shared.
+          Loading the snapshot in every worker avoids parsing the XML document in every worker, but not the memory
+          of a tree per worker.
+
+      Args:
+          data (collections.abc.Buffer): The binary snapshot saved by :meth:`.save_snapshot`.
+
+      Raises:
+          ValueError: If *data* is not a valid snapshot.
+
+      See Also:
+          :meth:`.save_snapshot`
+
+      Examples:
+          >>> from multiprocessing import shared_memory
+          >>> from pugixml import pugi
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_file('large.xml')
+          >>> data = doc.save_snapshot()
+          >>> shm = shared_memory.SharedMemory(name='large-xml', create=True, size=len(data))
+          >>> shm.buf[:len(data)] = data
+
+          In each worker process, which builds its own copy of the tree:
+
+          >>> from multiprocessing import shared_memory
+          >>> from pugixml import pugi
+          >>> shm = shared_memory.SharedMemory(name='large-xml')
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_snapshot(shm.buf)
+          >>> shm.close()
+      )doc");
+
+  xdoc.def(
+      "__copy__",
+      [](const xml_document &self) {
+        auto doc = std::make_unique<xml_document>();
+        doc->reset(self);
+        return doc;
+      },
+      R"doc(
+      Return a copy of the document.
+
+      Returns:
+          XMLDocument: A new document with a copy of the entire contents of this document.
+      )doc");
+
+  xdoc.def(
+      "__deepcopy__",
+      [](const xml_document &self, const py::object &) {
+        auto doc = std::make_unique<xml_document>();
+        doc->reset(self);
+        return doc;
+      },
+      py::arg("memo"),
+      R"doc(
+      Return a copy of the document.
+
+      Args:
+          memo (dict): The dictionary of objects already copied.
+
+      Returns:
+          XMLDocument: A new document with a copy of the entire contents of this document.
+      )doc");
+
+  xdoc.def(py::pickle([](const xml_document &self) { return save_snapshot(self); },
+                      [](const py::bytes &state) {
+                        auto doc = std::make_unique<xml_document>();
+                        const auto view = static_cast<std::string_view>(state);
+                        load_snapshot(*doc, view.data(), view.size());
+                        return doc;
+                      }));
+
+  //
+  // XMLFeedParser
+  //
+  fdp.def(py::init<xml_document &, unsigned int, xml_encoding>(), py::keep_alive<1, 2>(), py::arg("document"),
+          py::arg("options") = parse_default, py::arg("encoding") = encoding_auto,
+          R"doc(
+          Initialize ``XMLFeedParser``.
+
+          Args:
+              document (XMLDocument): The document to load.
+              options (int): The :pugixml:`parsing options <manual.html#loading.options>`.
+              encoding (XMLEncoding): The :pugixml:`input encoding <manual.html#loading.encoding>`.
+          )doc");
+
+  fdp.def("__len__", &FeedParser::size, R"doc(
+      Return the size of the fed data in bytes.
+
+      Returns:
+          int: The size of the fed data in bytes.
+      )doc");
+
+  fdp.def_property_readonly("closed", &FeedParser::closed, R"doc(
+      bool: :obj:`True` if the parser is closed, :obj:`False` otherwise.
+      )doc");
+
+  options.disable_function_signatures();
+  fdp.def("feed", &FeedParser::feed, py::arg("data"),
+          R"doc(
+          feed(self: pugixml.pugi.XMLFeedParser, data: collections.abc.Buffer) -> None
+
+          Append a chunk of the document.
+
+          Args:
+              data (collections.abc.Buffer): The chunk of the document.
+
+          Raises:
+              ValueError: If the parser is closed.
+          )doc");
+  options.enable_function_signatures();
+
+  fdp.def("close", &FeedParser::close,
+          R"doc(
+          Load the document from the fed data with the GIL released.
 
-           Examples:
-               A simple example of saving an XML document to a file:
+          The existing document tree is destroyed.
 
-               >>> from pugixml import pugi
-               >>> class FileWriter(pugi.XMLWriter):
-               ...     def __init__(self, path) -> None:
-               ...         super().__init__()
-               ...         self._file = open(path, 'wb')
-               ...     def close(self) -> None:
-               ...         self._file.close()
-               ...     def write(self, data: bytes, size: int) -> None:
-               ...         self._file.write(data)
+          Returns:
+              XMLParseResult: The result of the operation.
 
-               >>> from contextlib import closing
-               >>> doc = pugi.XMLDocument()
-               >>> doc.append_child('node')
-               >>> with closing(FileWriter('tree.xml')) as writer:
-               ...     doc.save(writer)
-           )doc");
-  options.enable_function_signatures();
+          Raises:
+              ValueError: If the parser is already closed.
+          )doc");
 
   options.disable_function_signatures();
-  xdoc.def(
-      "save_file",
-      [](const xml_document &self, const fs::path &path, const char_t *indent, unsigned int flags,
-         xml_encoding encoding) { return self.save_file(path.string<char>().c_str(), indent, flags, encoding); },
-      py::arg("path"), py::arg("indent").none(false) = PUGIXML_TEXT("\t"),
-      py::arg_v("flags", format_default, "pugixml.pugi.FORMAT_DEFAULT"), py::arg("encoding") = encoding_auto,
+  fdp.def(
+      "close_async",
+      [](py::object self) {
+        auto &parser = self.cast<FeedParser &>();
+        // The worker may start as soon as the work is submitted, so the parser is closed before that.
+        parser.set_closed();
+        try {
+          return run_in_executor(py::cpp_function([self, parser = &parser]() {
+            py::gil_scoped_release release;
+            return parser->load();
+          }));
+        } catch (...) {
+          parser.reopen();
+          throw;
+        }
+      },
       R"doc(
-      save_file(self: pugixml.pugi.XMLDocument, path: os.PathLike, indent: str = '\t', flags: int = pugixml.pugi.FORMAT_DEFAULT, encoding: pugixml.pugi.XMLEncoding = pugixml.pugi.ENCODING_AUTO) -> bool
+      close_async(self: pugixml.pugi.XMLFeedParser) -> asyncio.Future[pugixml.pugi.XMLParseResult]
 
-      Save the XML document to a file.
+      Load the document from the fed data in a worker thread.
 
-      Args:
-          path (os.PathLike): The path-like object to save the XML document.
-          indent (str): The indentation character(s).
-          flags (int): The :pugixml:`output options <manual.html#saving.options>`.
-          encoding (XMLEncoding): The :pugixml:`output encoding <manual.html#saving.encoding>`.
+      The data is parsed in the default executor of the running event loop with the GIL released; the returned
+      future is resolved with the result when the document is loaded. The existing document tree is destroyed.
+
+      Note:
+          Do not access or modify the document until the future is done.
 
       Returns:
-          bool: :obj:`True` if the saving was successful, :obj:`False` otherwise.
-      )doc");
-  options.enable_function_signatures();
+          asyncio.Future[XMLParseResult]: The future of the result of the operation.
 
-  xdoc.def("document_element", &xml_document::document_element,
-           R"doc(
-           Return the document element.
+      Raises:
+          RuntimeError: If there is no running event loop.
+          ValueError: If the parser is already closed.
 
-           Returns:
-               XMLNode: The element whose parent is this document, or empty node if not exists.
-           )doc");
+      Examples:
+          >>> import asyncio
+          >>> from pugixml import pugi
+          >>> async def load(reader: asyncio.StreamReader):
+          ...     doc = pugi.XMLDocument()
+          ...     parser = pugi.XMLFeedParser(doc)
+          ...     while chunk := await reader.read(65536):
+          ...         parser.feed(chunk)
+          ...     result = await parser.close_async()
+          ...     return doc if result else None
+      )doc");
+  options.enable_function_signatures();
 
   //
   // pugi::xpath_parse_result
@@ -2588,8 +6597,8 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   //
   // pugi::xpath_query
   //
-  xpq.def(py::init<const char_t *, xpath_variable_set *>(), py::arg("query").none(false),
-          py::arg("variables") = nullptr, "\tInitialize ``XPathQuery`` with the XPath expression and variables.")
+  xpq.def(py::init(&compile_xpath_query), py::arg("query").none(false), py::arg("variables") = nullptr,
+          "\tInitialize ``XPathQuery`` with the XPath expression and variables.")
       .def(py::init<>(), "\tInitialize ``XPathQuery`` as an invalid expression.\n\n"
                          "Args:\n"
                          "    query (str): The XPath expression.\n"
@@ -2612,11 +6621,21 @@ PYBIND11_MODULE(MODULE_NAME, m) {
               XPathValueType: The return type of the XPath expression.
           )doc");
 
-  xpq.def("evaluate_boolean", &xpath_query::evaluate_boolean, py::arg("node"),
+  xpq.def(
+          "evaluate_boolean",
+          [](const xpath_query &self, const xpath_node &node) {
+            ScopedOperation operation(Operation::select);
+            return self.evaluate_boolean(node);
+          },
+          py::arg("node"),
           "\tEvaluate the expression as a boolean value in the specified context; performs type conversion if "
           "necessary.")
       .def(
-          "evaluate_boolean", [](const xpath_query &self, const xml_node &node) { return self.evaluate_boolean(node); },
+          "evaluate_boolean",
+          [](const xpath_query &self, const xml_node &node) {
+            ScopedOperation operation(Operation::select);
+            return self.evaluate_boolean(node);
+          },
           py::arg("node"),
           "\tEvaluate the expression as a boolean value in the specified context; performs type conversion if "
           "necessary.\n\n"
@@ -2625,11 +6644,21 @@ PYBIND11_MODULE(MODULE_NAME, m) {
           "Returns:\n"
           "    bool: The value evaluated as a boolean, or :obj:`False` if error occurs.");
 
-  xpq.def("evaluate_number", &xpath_query::evaluate_number, py::arg("node"),
+  xpq.def(
+          "evaluate_number",
+          [](const xpath_query &self, const xpath_node &node) {
+            ScopedOperation operation(Operation::select);
+            return self.evaluate_number(node);
+          },
+          py::arg("node"),
           "\tEvaluate the expression as a number in the specified context; performs type conversion if "
           "necessary.")
       .def(
-          "evaluate_number", [](const xpath_query &self, const xml_node &node) { return self.evaluate_number(node); },
+          "evaluate_number",
+          [](const xpath_query &self, const xml_node &node) {
+            ScopedOperation operation(Operation::select);
+            return self.evaluate_number(node);
+          },
           py::arg("node"),
           "\tEvaluate the expression as a number in the specified context; performs type conversion if "
           "necessary.\n\n"
@@ -2638,11 +6667,20 @@ PYBIND11_MODULE(MODULE_NAME, m) {
           "Returns:\n"
           "    float: The value evaluated as a number, or ``float('nan')`` if error occurs.");
 
-  xpq.def("evaluate_string", py::overload_cast<const xpath_node &>(&xpath_query::evaluate_string, py::const_),
+  xpq.def(
+          "evaluate_string",
+          [](const xpath_query &self, const xpath_node &node) {
+            ScopedOperation operation(Operation::select);
+            return self.evaluate_string(node);
+          },
           py::arg("node"),
           "\tEvaluate the expression as a string in the specified context; performs type conversion if necessary.")
       .def(
-          "evaluate_string", [](const xpath_query &self, const xml_node &node) { return self.evaluate_string(node); },
+          "evaluate_string",
+          [](const xpath_query &self, const xml_node &node) {
+            ScopedOperation operation(Operation::select);
+            return self.evaluate_string(node);
+          },
           py::arg("node"),
           "\tEvaluate the expression as a string in the specified context; performs type conversion if necessary.\n\n"
           "Args:\n"
@@ -2650,11 +6688,25 @@ PYBIND11_MODULE(MODULE_NAME, m) {
           "Returns:\n"
           "    str: The value evaluated as a string, or the empty string if error occurs.");
 
-  xpq.def("evaluate_node_set", &xpath_query::evaluate_node_set, py::arg("node"),
+  xpq.def(
+          "evaluate_node_set",
+          [](const xpath_query &self, const xpath_node &node) {
+            ScopedOperation operation(Operation::select);
+            auto result = self.evaluate_node_set(node);
+            operation.add_nodes(result.size());
+            return result;
+          },
+          py::keep_alive<0, 2>(), py::arg("node"),
           "\tEvaluate the expression as a node set in the specified context; performs type conversion if necessary.")
       .def(
           "evaluate_node_set",
-          [](const xpath_query &self, const xml_node &node) { return self.evaluate_node_set(node); }, py::arg("node"),
+          [](const xpath_query &self, const xml_node &node) {
+            ScopedOperation operation(Operation::select);
+            auto result = self.evaluate_node_set(node);
+            operation.add_nodes(result.size());
+            return result;
+          },
+          py::keep_alive<0, 2>(), py::arg("node"),
           "\tEvaluate the expression as a node set in the specified context; performs type conversion if necessary.\n\n"
           "Args:\n"
           "    node (typing.Union[XPathNode, XMLNode]): The node to evaluate over.\n\n"
@@ -2663,11 +6715,25 @@ PYBIND11_MODULE(MODULE_NAME, m) {
           "See Also:\n"
           "    :meth:`XMLNode.select_nodes`");
 
-  xpq.def("evaluate_node", &xpath_query::evaluate_node, py::arg("node"),
+  xpq.def(
+          "evaluate_node",
+          [](const xpath_query &self, const xpath_node &node) {
+            ScopedOperation operation(Operation::select);
+            auto result = self.evaluate_node(node);
+            operation.add_nodes(result ? 1 : 0);
+            return result;
+          },
+          py::keep_alive<0, 2>(), py::arg("node"),
           "\tEvaluate the expression as a node set in the specified context; performs type conversion if necessary.")
       .def(
-          "evaluate_node", [](const xpath_query &self, const xml_node &node) { return self.evaluate_node(node); },
-          py::arg("node"),
+          "evaluate_node",
+          [](const xpath_query &self, const xml_node &node) {
+            ScopedOperation operation(Operation::select);
+            auto result = self.evaluate_node(node);
+            operation.add_nodes(result ? 1 : 0);
+            return result;
+          },
+          py::keep_alive<0, 2>(), py::arg("node"),
           "\tEvaluate the expression as a node set in the specified context; performs type conversion if necessary.\n\n"
           "Args:\n"
           "    node (typing.Union[XPathNode, XMLNode]): The node to evaluate over.\n\n"
@@ -2688,8 +6754,10 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   // pugi::xpath_node
   //
   xpn.def(py::init<>(), "\tInitialize ``XPathNode`` as an empty XPath node.")
-      .def(py::init<const xml_node &>(), py::arg("node"), "\tInitialize ``XPathNode`` with the node.")
-      .def(py::init<const xml_attribute &, const xml_node &>(), py::arg("attribute"), py::arg("parent"),
+      .def(py::init<const xml_node &>(), py::keep_alive<1, 2>(), py::arg("node"),
+           "\tInitialize ``XPathNode`` with the node.")
+      .def(py::init<const xml_attribute &, const xml_node &>(), py::keep_alive<1, 3>(), py::arg("attribute"),
+           py::arg("parent"),
            "\tInitialize ``XPathNode`` with the attribute and its parent node.\n\n"
            "Args:\n"
            "    node (XMLNode): The node to evaluate over.\n"
@@ -2729,7 +6797,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
           "Returns:\n"
           "    bool: The result of comparing pointers of internal objects.");
 
-  xpn.def("node", &xpath_node::node,
+  xpn.def("node", &xpath_node::node, py::keep_alive<0, 1>(),
           R"doc(
           Return the node if any.
 
@@ -2737,7 +6805,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
               XMLNode: The node if any, empty node otherwise.
           )doc");
 
-  xpn.def("attribute", &xpath_node::attribute,
+  xpn.def("attribute", &xpath_node::attribute, py::keep_alive<0, 1>(),
           R"doc(
           Return the attribute if any.
 
@@ -2745,7 +6813,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
               XMLAttribute: The attribute if any, empty attribute otherwise.
           )doc");
 
-  xpn.def("parent", &xpath_node::parent,
+  xpn.def("parent", &xpath_node::parent, py::keep_alive<0, 1>(),
           R"doc(
           Return the parent node.
 
@@ -2764,7 +6832,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
       .finalize();
 
   xpns.def(py::init<>(), "\tInitialize ``XPathNodeSet`` as an empty collection.")
-      .def(py::init<const xpath_node_set &>(), py::arg("other"),
+      .def(py::init<const xpath_node_set &>(), py::keep_alive<1, 2>(), py::arg("other"),
            "\tInitialize ``XPathNodeSet`` with a copy of the collection.\n\n"
            "Args:\n"
            "    other (XPathNodeSet): The collection to copy.");
@@ -2780,29 +6848,16 @@ PYBIND11_MODULE(MODULE_NAME, m) {
             }
             return self[index];
           },
-          py::arg("index"), "\tReturn the XPath node at the specified index from the collection.")
-      .def(
-          "__getitem__",
-          [](const xpath_node_set &self, const py::slice &slice) {
-            size_t start = 0, stop = 0, step = 0, slice_length = 0;
-            if (!slice.compute(self.size(), &start, &stop, &step, &slice_length)) {
-              throw py::error_already_set();
-            }
-            std::vector<xpath_node> result(slice_length);
-            for (size_t n = 0; n < slice_length; ++n) {
-              result[n] = self[start];
-              start += step;
-            }
-            return result;
-          },
-          py::arg("slice"),
-          "\tReturn a list of XPath nodes at the specified :obj:`slice` from the collection.\n\n"
-          "Args:\n"
-          "    index (int): An index to specify position.\n"
-          "    slice (slice): A slice object to specify range.\n\n"
-          "Returns:\n"
-          "    typing.Union[XPathNode, typing.List[XPathNode]]: The XPath node(s) at the specified index/slice from "
-          "collection.");
+          py::keep_alive<0, 1>(), py::arg("index"),
+          "\tReturn the XPath node at the specified index from the collection.")
+      .def("__getitem__", &get_slice, py::arg("slice"),
+           "\tReturn a list of XPath nodes at the specified :obj:`slice` from the collection.\n\n"
+           "Args:\n"
+           "    index (int): An index to specify position.\n"
+           "    slice (slice): A slice object to specify range.\n\n"
+           "Returns:\n"
+           "    typing.Union[XPathNode, typing.List[XPathNode]]: The XPath node(s) at the specified index/slice from "
+           "collection.");
 
   options.disable_function_signatures();
   xpns.def(
@@ -2855,7 +6910,7 @@ PYBIND11_MODULE(MODULE_NAME, m) {
                reverse (bool): If :obj:`True`, sort in descending order.
            )doc");
 
-  xpns.def("first", &xpath_node_set::first,
+  xpns.def("first", &xpath_node_set::first, py::keep_alive<0, 1>(),
            R"doc(
            Return the first node in the collection by document order.
 
@@ -2874,11 +6929,6 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   //
   // BytesWriter
   //
-  struct BytesWriter : public xml_writer {
-    std::string contents;
-    void write(const void *data, size_t size) override { contents.append(static_cast<const char *>(data), size); }
-  };
-
   py::class_<BytesWriter, xml_writer>(m, "BytesWriter", R"doc(
       (pugixml-python only) :class:`XMLWriter` implementation for :obj:`bytes`.
 
@@ -2912,32 +6962,6 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   //
   // FileWriter
   //
-  struct FileWriter : public xml_writer {
-    std::ofstream file;
-    FileWriter(const fs::path &path) {
-      try {
-        file.open(path, std::ios_base::out | std::ios_base::binary);
-        file.exceptions(std::ios_base::failbit | std::ios_base::badbit);
-      } catch (const std::exception &e) {
-        PyErr_SetString(PyExc_OSError, e.what());
-        throw py::error_already_set();
-      }
-    }
-    void close() {
-      if (file.is_open()) {
-        file.close();
-      }
-    }
-    void write(const void *data, size_t size) override {
-      try {
-        file.write(static_cast<const char *>(data), size);
-      } catch (const std::exception &e) {
-        PyErr_SetString(PyExc_OSError, e.what());
-        throw py::error_already_set();
-      }
-    }
-  };
-
   py::class_<FileWriter, xml_writer>(m, "FileWriter", R"doc(
       (pugixml-python only) :class:`XMLWriter` implementation for a file.
 
@@ -3061,6 +7085,130 @@ PYBIND11_MODULE(MODULE_NAME, m) {
               str: The entire contents of the buffer.
           )doc");
 
+  options.disable_function_signatures();
+  m.def(
+      "load_file_fragments",
+      [](const fs::path &path, const char_t *split_tag, size_t threads, unsigned int options,
+         const std::optional<std::string> &compression) {
+        const auto codec = get_compression(compression, path, true);
+        const auto tag = to_utf8(split_tag);
+        if (tag.empty()) {
+          throw py::value_error("split_tag must not be empty");
+        }
+        std::vector<xml_document> fragments;
+        xml_parse_result result;
+        {
+          py::gil_scoped_release release;
+          const auto count = threads > 0 ? threads : std::thread::hardware_concurrency();
+          result = load_file_fragments(fragments, path, tag, count, options, codec);
+        }
+        if (!result) {
+          throw py::value_error(std::string(result.description()) + " at offset " + std::to_string(result.offset));
+        }
+        py::list documents;
+        for (auto &fragment : fragments) {
+          documents.append(py::cast(std::make_unique<xml_document>(std::move(fragment))));
+        }
+        return documents;
+      },
+      py::arg("path"), py::arg("split_tag").none(false), py::arg("threads") = 0, py::arg("options") = parse_default,
+      py::arg("compression") = py::none(),
+      R"doc(
+      load_file_fragments(path: os.PathLike, split_tag: str, threads: int = 0, options: int = pugixml.pugi.PARSE_DEFAULT, compression: typing.Optional[str] = None) -> list[pugixml.pugi.XMLDocument]
+
+      (pugixml-python only) Load the records of a large UTF-8 file in parallel as separate documents.
+
+      The file is split into runs of the records named *split_tag* as in :meth:`XMLDocument.load_file_parallel`, and
+      each run is parsed with :data:`PARSE_FRAGMENT` into its own document in *threads* threads with the GIL released.
+      Unlike :meth:`XMLDocument.load_file_parallel`, the records are not copied into one document, so the parsing
+      is not followed by a serial step. The ancestors of the records, and the nodes before and after them, are not
+      loaded. If a run cannot be parsed on its own (e.g. a split point is in a comment, CDATA or a nested record),
+      all the records are parsed into one document.
+
+      Args:
+          path (os.PathLike): The path-like object of the document to parse.
+          split_tag (str): The name of the records.
+          threads (int): The number of threads, or 0 to use the number of CPUs.
+          options (int): The :pugixml:`parsing options <manual.html#loading.options>`.
+          compression (typing.Optional[str]): The compression of the file (see :meth:`XMLDocument.load_file`).
+
+      Returns:
+          list[XMLDocument]: The documents of the runs of records in order, or an empty list if there are no records.
+
+      Raises:
+          ValueError: If the file cannot be read or parsed, *split_tag* is empty, or the compression is not supported.
+
+      See Also:
+          :meth:`XMLDocument.load_file_parallel`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> for fragment in pugi.load_file_fragments('export.xml', 'record', threads=8):
+          ...     for record in fragment.children('record'):
+          ...         pass
+      )doc");
+  options.enable_function_signatures();
+
+  m.def(
+      "parse_numbers",
+      [](const py::handle &values, const std::string &type) {
+        const auto it = _column_type_to_typecode.find(type);
+        const auto typecode = it != _column_type_to_typecode.end() ? it->second : 0;
+        switch (typecode) {
+        case 'd':
+          return parse_numbers<double>(values, typecode);
+        case 'f':
+          return parse_numbers<float>(values, typecode);
+        case 'i':
+          return parse_numbers<int>(values, typecode);
+        case 'I':
+          return parse_numbers<unsigned int>(values, typecode);
+        case 'q':
+          return parse_numbers<long long>(values, typecode);
+        case 'Q':
+          return parse_numbers<unsigned long long>(values, typecode);
+        default:
+          throw py::value_error("unsupported number type: " + type);
+        }
+      },
+      py::arg("values"), py::arg("type") = "double",
+      R"doc(
+      (pugixml-python only) Convert many values to numbers in one call.
+
+      The values are converted with ``std::from_chars()``; the leading and trailing whitespace, and a leading ``+``
+      are ignored, and the integers may be hexadecimal with the ``0x`` prefix.
+      Unlike :meth:`XMLAttribute.as_int`, etc., the values that are empty, out of range or followed by other
+      characters are not substituted silently, but reported as errors.
+
+      Args:
+          values (typing.Union[XPathNodeSet, typing.Iterable[typing.Union[str, XMLAttribute, XMLNode, XMLText, XPathNode]]]):
+              The values to convert. For :class:`XMLNode`, the text of the node (see :meth:`XMLNode.text`) is
+              converted; for :class:`XPathNode`, the attribute value or the text of the node.
+          type (str): The number type, one of ``'int'``, ``'uint'``, ``'llong'``, ``'ullong'``, ``'float'`` or
+              ``'double'``.
+
+      Returns:
+          typing.Tuple[array.array, typing.List[int]]: The numbers as :obj:`array.array` with the typecode ``'i'``,
+          ``'I'``, ``'q'``, ``'Q'``, ``'f'`` or ``'d'`` respectively, and the indices of the values that are not valid
+          numbers (converted to ``0``).
+
+      Raises:
+          TypeError: If a value is not a string, node or attribute.
+          ValueError: If the number type is not supported.
+
+      See Also:
+          :meth:`XMLNode.extract_columns`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_string('<rows><row n="1"/><row n=" 0x10 "/><row n="x"/><row n="4"/></rows>')
+          >>> pugi.parse_numbers(doc.select_nodes('//row/@n'), 'int')
+          (array('i', [1, 16, 0, 4]), [2])
+          >>> pugi.parse_numbers(['1.5', '2e3'])
+          (array('d', [1.5, 2000.0]), [])
+      )doc");
+
   //
   // pugixml.pugi.limits submodule
   //
@@ -3078,4 +7226,296 @@ PYBIND11_MODULE(MODULE_NAME, m) {
   m2.attr("LLONG_MIN") = std::numeric_limits<long long>::min();
   m2.attr("UINT_MAX") = std::numeric_limits<unsigned int>::max();
   m2.attr("ULLONG_MAX") = std::numeric_limits<unsigned long long>::max();
+
+  //
+  // pugixml.pugi.memory submodule
+  //
+  auto m3 = m.def_submodule("memory");
+
+  m3.doc() = "(pugixml-python only) Memory allocators for the document trees.";
+
+  m3.attr("TRACEMALLOC_DOMAIN") = _tracemalloc_domain;
+
+  m3.def(
+      "get_allocator", []() { return _memory_backend.load()->name(); },
+      R"doc(
+      Return the name of the allocator used for new memory blocks.
+
+      Returns:
+          str: The name of the allocator.
+
+      See Also:
+          :func:`.set_allocator`
+      )doc");
+
+  m3.def(
+      "set_allocator",
+      [](const std::string &name) {
+        for (const auto backend : _memory_backends) {
+          if (name == backend->name()) {
+            _memory_backend.store(backend);
+            return;
+          }
+        }
+        throw py::value_error("unknown allocator: " + name);
+      },
+      py::arg("name"),
+      R"doc(
+      Set the allocator used for new memory blocks of the document trees, XPath queries, etc.
+
+      The memory blocks allocated before the change are still released by the allocator that allocated them.
+
+      Args:
+          name (str): The name of the allocator, one of:
+
+              - ``'system'`` (default): Allocate each block with ``malloc()``.
+              - ``'arena'``: Allocate the blocks from 1 MiB chunks; a chunk is released when all of its blocks are
+                freed.
+              - ``'pool'``: Round up the blocks to size classes and reuse the freed blocks (up to 64 MiB).
+
+      Raises:
+          ValueError: If the allocator is unknown.
+
+      See Also:
+          :func:`.get_allocator`, :func:`.stats`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> pugi.memory.set_allocator('pool')
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_string('<node/>')
+          >>> pugi.memory.stats()['live_blocks'] > 0
+          True
+      )doc");
+
+  m3.def(
+      "set_block_tracking", [](bool enabled) { _block_tracking = enabled; }, py::arg("enabled"),
+      R"doc(
+      Enable or disable the registry of the memory blocks used by :meth:`XMLDocument.memory_usage`.
+
+      While enabled, every allocation and deallocation of pugixml updates a registry shared by all threads under a
+      lock, so it is disabled by default. The blocks allocated before enabling are not registered.
+
+      Args:
+          enabled (bool): :obj:`True` to register the memory blocks, :obj:`False` otherwise.
+
+      See Also:
+          :meth:`XMLDocument.memory_usage`
+      )doc");
+
+  m3.def(
+      "set_tracemalloc", [](bool enabled) { set_tracemalloc(enabled); }, py::arg("enabled"),
+      R"doc(
+      Enable or disable tracking of the memory blocks allocated by pugixml in :mod:`tracemalloc`.
+
+      The memory blocks are tracked in the domain :attr:`.TRACEMALLOC_DOMAIN` while :mod:`tracemalloc` is tracing;
+      the blocks allocated before enabling are not tracked, and the tracked blocks are untracked when disabled.
+
+      Args:
+          enabled (bool): :obj:`True` to track the memory blocks, :obj:`False` otherwise.
+
+      Examples:
+          >>> import tracemalloc
+          >>> from pugixml import pugi
+          >>> tracemalloc.start()
+          >>> pugi.memory.set_tracemalloc(True)
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_string('<node/>')
+          >>> snapshot = tracemalloc.take_snapshot().filter_traces(
+          ...     [tracemalloc.DomainFilter(True, pugi.memory.TRACEMALLOC_DOMAIN)])
+          >>> sum(stat.size for stat in snapshot.statistics('filename')) > 0
+          True
+      )doc");
+
+  m3.def(
+      "stats",
+      []() {
+        uint64_t reserved_bytes = 0;
+        for (const auto backend : _memory_backends) {
+          reserved_bytes += backend->reserved_bytes_.load();
+        }
+        py::dict result;
+        result["allocator"] = _memory_backend.load()->name();
+        result["allocations"] = _memory_stats.allocations.load();
+        result["deallocations"] = _memory_stats.deallocations.load();
+        result["bytes_allocated"] = _memory_stats.bytes_allocated.load();
+        result["live_blocks"] = _memory_stats.live_blocks.load();
+        result["live_bytes"] = _memory_stats.live_bytes.load();
+        result["peak_bytes"] = _memory_stats.peak_bytes.load();
+        result["reserved_bytes"] = reserved_bytes;
+        result["reused_blocks"] = _memory_stats.reused_blocks.load();
+        {
+          std::lock_guard<std::mutex> lock(*_retained_blocks_mutex);
+          result["retained_blocks"] = _retained_blocks->size();
+          result["retained_bytes"] = _retained_bytes.load();
+        }
+        return result;
+      },
+      R"doc(
+      Return the counters of the memory allocated by pugixml.
+
+      Returns:
+          typing.Dict[str, typing.Union[str, int]]: The counters:
+
+          - ``allocator``: The name of the current allocator.
+          - ``allocations``: The number of blocks allocated.
+          - ``deallocations``: The number of blocks freed.
+          - ``bytes_allocated``: The total size of the blocks allocated, in bytes.
+          - ``live_blocks``: The number of blocks (memory pages, large strings, etc.) in use.
+          - ``live_bytes``: The total size of the blocks in use, in bytes.
+          - ``peak_bytes``: The maximum of ``live_bytes``.
+          - ``reserved_bytes``: The size of the memory obtained from the system by the allocators, including the
+            block headers, the unused space of the arena chunks and the free blocks of the pool.
+          - ``reused_blocks``: The number of blocks allocated from the retained blocks.
+          - ``retained_blocks``: The number of blocks retained by :meth:`XMLDocument.reset` for reuse.
+          - ``retained_bytes``: The total size of the retained blocks, in bytes.
+
+      See Also:
+          :func:`.reset_stats`, :func:`.trim`
+      )doc");
+
+  m3.def(
+      "reset_stats",
+      []() {
+        _memory_stats.allocations = 0;
+        _memory_stats.deallocations = 0;
+        _memory_stats.bytes_allocated = 0;
+        _memory_stats.reused_blocks = 0;
+        _memory_stats.peak_bytes = _memory_stats.live_bytes.load();
+      },
+      R"doc(
+      Reset the cumulative counters, and set ``peak_bytes`` to the current ``live_bytes``.
+
+      See Also:
+          :func:`.stats`
+      )doc");
+
+  m3.def(
+      "trim",
+      []() {
+        release_retained_blocks();
+        for (const auto backend : _memory_backends) {
+          backend->trim();
+        }
+      },
+      R"doc(
+      Release the free memory cached by the allocators, and the blocks retained for reuse, to the system.
+
+      See Also:
+          :func:`.stats`
+      )doc");
+
+  //
+  // pugixml.pugi.stats submodule
+  //
+  auto m4 = m.def_submodule("stats");
+
+  m4.doc() = "(pugixml-python only) Counters and timings of the load, save, select and traverse operations.";
+
+  m4.def(
+      "disable", []() { _stats_enabled = false; },
+      R"doc(
+      Stop recording the operations.
+
+      The recorded counters are kept until :func:`.reset` is called.
+
+      See Also:
+          :func:`.enable`
+      )doc");
+
+  m4.def(
+      "enable", []() { _stats_enabled = true; },
+      R"doc(
+      Start recording the operations.
+
+      The counters are disabled by default; while they are disabled, the operations are not measured at all.
+
+      See Also:
+          :func:`.disable`, :func:`.snapshot`
+
+      Examples:
+          >>> from pugixml import pugi
+          >>> pugi.stats.enable()
+          >>> doc = pugi.XMLDocument()
+          >>> doc.load_string('<node><child/></node>')
+          >>> len(doc.select_nodes('//child'))
+          1
+          >>> pugi.stats.disable()
+          >>> stats = pugi.stats.snapshot()
+          >>> stats['load']['calls'], stats['select']['nodes']
+          (1, 1)
+      )doc");
+
+  m4.def(
+      "is_enabled", []() { return _stats_enabled.load(); },
+      R"doc(
+      Return whether the operations are recorded.
+
+      Returns:
+          bool: :obj:`True` if the operations are recorded, :obj:`False` otherwise.
+      )doc");
+
+  m4.def(
+      "reset",
+      []() {
+        for (auto &stats : _operation_stats) {
+          stats.calls = 0;
+          stats.bytes = 0;
+          stats.nodes = 0;
+          stats.time_ns = 0;
+          stats.allocations = 0;
+          stats.allocated_bytes = 0;
+        }
+      },
+      R"doc(
+      Reset all counters to zero.
+
+      See Also:
+          :func:`.snapshot`
+      )doc");
+
+  m4.def(
+      "snapshot",
+      []() {
+        py::dict result;
+        for (size_t index = 0; index < std::size(_operation_names); ++index) {
+          const auto &stats = _operation_stats[index];
+          py::dict item;
+          item["calls"] = stats.calls.load();
+          item["bytes"] = stats.bytes.load();
+          item["nodes"] = stats.nodes.load();
+          item["time_ns"] = stats.time_ns.load();
+          item["allocations"] = stats.allocations.load();
+          item["allocated_bytes"] = stats.allocated_bytes.load();
+          result[_operation_names[index]] = item;
+        }
+        return result;
+      },
+      R"doc(
+      Return the counters recorded for each operation.
+
+      The operations are:
+
+      - ``load``: :meth:`XMLDocument.load_buffer`, :meth:`XMLDocument.load_file` and :meth:`XMLDocument.load_string`.
+      - ``save``: :meth:`XMLDocument.save`, :meth:`XMLDocument.save_file` and :meth:`XMLNode.print`.
+      - ``select``: :meth:`XMLNode.select_node`, :meth:`XMLNode.select_nodes` and the ``evaluate_*`` methods of
+        :class:`XPathQuery`.
+      - ``traverse``: :meth:`XMLNode.traverse`.
+      - ``compile``: The compilation of the XPath expressions by :class:`XPathQuery` and by
+        :meth:`XMLNode.select_node` / :meth:`XMLNode.select_nodes` with a string.
+
+      Returns:
+          typing.Dict[str, typing.Dict[str, int]]: The counters of each operation:
+
+          - ``calls``: The number of calls.
+          - ``bytes``: The size of the input (``load``), the output (``save``) or the XPath expressions
+            (``compile``), in bytes.
+          - ``nodes``: The number of nodes selected (``select``) or visited (``traverse``).
+          - ``time_ns``: The total elapsed time, in nanoseconds.
+          - ``allocations``: The number of memory blocks allocated by pugixml during the calls.
+          - ``allocated_bytes``: The total size of the memory blocks allocated during the calls, in bytes.
+
+      See Also:
+          :func:`.enable`, :func:`.reset`
+      )doc");
 }
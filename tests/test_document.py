@@ -1,7 +1,16 @@
 from __future__ import annotations
 
+import asyncio
+import copy
+import gc
+import gzip
+import mmap
 import os
+import pickle
+import struct
 import tempfile
+import weakref
+from multiprocessing import shared_memory
 from pathlib import Path
 
 import pytest
@@ -22,12 +31,124 @@ class _TestWriter(pugi.XMLWriter):
         self._contents += data
 
 
+def _save_raw(doc: pugi.XMLDocument) -> str:
+    writer = pugi.StringWriter()
+    doc.save(writer, flags=pugi.FORMAT_RAW | pugi.FORMAT_NO_DECLARATION)
+    return writer.getvalue()
+
+
+_CODECS = {"gzip": "PUGIXML_ZLIB", "zstd": "PUGIXML_ZSTD"}
+
+
+def _compress(compression: str, data: bytes) -> bytes:
+    if compression == "gzip":
+        return gzip.compress(data)
+    return pytest.importorskip("compression.zstd").compress(data)
+
+
+def _decompress(compression: str, data: bytes) -> bytes:
+    if compression == "gzip":
+        return gzip.decompress(data)
+    return pytest.importorskip("compression.zstd").decompress(data)
+
+
+@pytest.fixture
+def block_tracking():
+    pugi.memory.set_block_tracking(True)
+    yield
+    pugi.memory.set_block_tracking(False)
+
+
 here = Path(__file__).parent
 testdata = (
     here / ".." / "src" / "third_party" / "pugixml" / "tests" / "data"
 ).resolve()
 
 
+def test_build_options() -> None:
+    assert set(pugi.BUILD_OPTIONS) == {
+        "PUGIXML_COMPACT",
+        "PUGIXML_WCHAR_MODE",
+        "PUGIXML_ZLIB",
+        "PUGIXML_ZSTD",
+    }
+    # tox run -e compact/wchar builds and tests with these variables
+    for name, enabled in pugi.BUILD_OPTIONS.items():
+        if name in os.environ:
+            assert enabled is (os.environ[name].upper() == "ON"), name
+
+    def bytes_per_node(name: str) -> float:
+        doc = pugi.XMLDocument()
+        live_bytes = pugi.memory.stats()["live_bytes"]
+        for _ in range(10000):
+            doc.append_child(pugi.NODE_ELEMENT).set_name(name)
+        return (pugi.memory.stats()["live_bytes"] - live_bytes) / 10000
+
+    # a node has 8 pointers, or 12 bytes in compact mode
+    pointer_size = struct.calcsize("P")
+    node_bytes = bytes_per_node("")
+    if pugi.BUILD_OPTIONS["PUGIXML_COMPACT"]:
+        assert node_bytes < 8 * pointer_size
+    else:
+        assert node_bytes >= 8 * pointer_size
+
+    # the names are stored as wchar_t in wchar mode
+    char_bytes = (bytes_per_node("x" * 64) - node_bytes) / 64
+    if pugi.BUILD_OPTIONS["PUGIXML_WCHAR_MODE"]:
+        assert char_bytes >= 2
+    else:
+        assert char_bytes < 2
+
+
+@pytest.mark.usefixtures("block_tracking")
+def test_compact() -> None:
+    doc = pugi.XMLDocument()
+    assert doc.compact() == 0
+
+    doc.load_string(
+        "<root>"
+        + "".join(f'<item id="{n}">text{n}</item>' for n in range(10000))
+        + "</root>"
+    )
+    root = doc.child("root")
+    for _ in range(9990):
+        root.remove_child(root.first_child())
+    writer = pugi.StringWriter()
+    doc.save(writer)
+    expected = writer.getvalue()
+    usage = doc.memory_usage()
+
+    reclaimed = doc.compact()
+    assert reclaimed > 0
+    assert reclaimed == usage["page_bytes"] - doc.memory_usage()["page_bytes"]
+    assert doc.memory_usage()["nodes"] == usage["nodes"]
+    assert doc.memory_usage()["wasted_bytes"] < usage["wasted_bytes"]
+
+    writer = pugi.StringWriter()
+    doc.save(writer)
+    assert writer.getvalue() == expected
+
+    root = doc.child("root")
+    assert root.first_child().attribute("id").as_int() == 9990
+    root.append_child("item").text().set("new")
+    assert root.last_child().text().get() == "new"
+
+
+def test_copy() -> None:
+    doc = pugi.XMLDocument()
+    doc.load_string("<node a='1'><child>text</child></node>")
+
+    for doc2 in (copy.copy(doc), copy.deepcopy(doc)):
+        assert isinstance(doc2, pugi.XMLDocument)
+        assert doc2 != doc
+        writer = pugi.StringWriter()
+        doc2.print(writer, flags=pugi.FORMAT_RAW)
+        assert writer.getvalue() == '<node a="1"><child>text</child></node>'
+
+    doc2.child("node").set_name("n")
+    assert doc.child("node")
+
+
 # https://github.com/zeux/pugixml/blob/master/tests/test_document.cpp
 # document_element()
 def test_document_element() -> None:
@@ -49,6 +170,71 @@ def test_document_element() -> None:
     assert node == doc.child("node")
 
 
+def test_feed_parser() -> None:
+    doc = pugi.XMLDocument()
+    doc.append_child("old")
+    parser = pugi.XMLFeedParser(doc)
+    assert not parser.closed
+    parser.feed(b"<node ")
+    parser.feed(bytearray(b'id="1">text'))
+    parser.feed(memoryview(b"</node>"))
+    assert len(parser) == 24
+    assert doc.first_child().name() == "old"
+
+    result = parser.close()
+    assert result
+    assert parser.closed
+    assert doc.first_child().name() == "node"
+    assert doc.first_child().attribute("id").as_int() == 1
+    assert doc.first_child().text().get() == "text"
+
+    with pytest.raises(ValueError, match="after close"):
+        parser.feed(b"<node/>")
+    with pytest.raises(ValueError, match="after close"):
+        parser.close()
+
+    parser = pugi.XMLFeedParser(doc, pugi.PARSE_MINIMAL | pugi.PARSE_FAST_SCAN)
+    parser.feed(b"<a><b>1</b>")
+    parser.feed(b"<b>2</b></a>")
+    assert parser.close()
+    assert [node.text().get() for node in doc.child("a").children()] == [
+        "1",
+        "2",
+    ]
+
+    parser = pugi.XMLFeedParser(doc)
+    result = parser.close()
+    assert result.status == pugi.STATUS_NO_DOCUMENT_ELEMENT
+
+    parser = pugi.XMLFeedParser(doc)
+    with pytest.raises(TypeError):
+        parser.feed("<node/>")
+
+
+def test_feed_parser_async() -> None:
+    async def load(doc: pugi.XMLDocument) -> pugi.XMLParseResult:
+        parser = pugi.XMLFeedParser(doc)
+        parser.feed(b"<root>")
+        for i in range(1000):
+            parser.feed(f'<item id="{i}"/>'.encode())
+        parser.feed(b"</root>")
+        future = parser.close_async()
+        assert parser.closed
+        with pytest.raises(ValueError, match="after close"):
+            parser.close_async()
+        return await future
+
+    doc = pugi.XMLDocument()
+    result = asyncio.run(load(doc))
+    assert result
+    assert len(doc.select_nodes("/root/item")) == 1000
+
+    parser = pugi.XMLFeedParser(doc)
+    with pytest.raises(RuntimeError):
+        parser.close_async()  # no running event loop
+    assert not parser.closed
+
+
 def test_hash_value() -> None:
     doc = pugi.XMLDocument()
 
@@ -56,6 +242,67 @@ def test_hash_value() -> None:
     assert hash(doc) == doc.hash_value()
 
 
+def test_keep_alive() -> None:
+    def load() -> tuple[pugi.XMLDocument, weakref.ref]:
+        doc = pugi.XMLDocument()
+        doc.load_string('<node attr="value"><child>text</child></node>')
+        return doc, weakref.ref(doc)
+
+    doc, ref = load()
+    node = doc.child("node")
+    del doc
+    gc.collect()
+    assert ref() is not None
+    assert node.child("child").text().get() == "text"
+    del node
+    gc.collect()
+    assert ref() is None
+
+    doc, ref = load()
+    attr = doc.child("node").attribute("attr")
+    text = doc.child("node").child("child").text()
+    xpath_node = doc.select_node("//child")
+    attrs = list(doc.child("node").attributes())
+    del doc
+    gc.collect()
+    assert attr.value() == "value"
+    assert text.get() == "text"
+    assert xpath_node.node().name() == "child"
+    assert attrs[0].name() == "attr"
+    del attr, text
+    gc.collect()
+    assert ref() is not None
+    del xpath_node, attrs
+    gc.collect()
+    assert ref() is None
+
+    doc, ref = load()
+    nodes = doc.select_nodes("//node/@attr")
+    del doc
+    gc.collect()
+    assert nodes[0].attribute().value() == "value"
+    assert nodes[0].parent().name() == "node"
+    del nodes
+    gc.collect()
+    assert ref() is None
+
+    doc, ref = load()
+    children = doc.child("node").children()[0:1]
+    xpath_nodes = doc.select_nodes("//child")[:]
+    xpath_node = pugi.XPathNode(doc.child("node").child("child"))
+    del doc
+    gc.collect()
+    assert children[0].name() == "child"
+    assert xpath_nodes[0].node().name() == "child"
+    del children, xpath_nodes
+    gc.collect()
+    assert ref() is not None
+    assert xpath_node.node().name() == "child"
+    del xpath_node
+    gc.collect()
+    assert ref() is None
+
+
 # https://github.com/zeux/pugixml/blob/master/tests/test_document.cpp
 # document_contents_preserve()
 def test_load_buffer() -> None:
@@ -102,6 +349,62 @@ def test_load_buffer() -> None:
                 assert contents2 == contents
 
 
+@pytest.mark.parametrize(
+    "contents",
+    [
+        '<log><entry level="info">'
+        + "x" * 100_000
+        + " &amp; \r\n</entry><entry/></log>",
+        '<?xml version="1.0" encoding="UTF-8"?>\n'
+        "<root a = '1'  b=\"x>y\">  <c/>\n text </root>\n",
+        "\ufeff<r>\u6771\u4eac</r>",
+        "lead<r> </r >trail",
+        "<r><!-- comment --></r>",
+        "<?xml version='1.0' encoding='latin1'?><r>text</r>",
+        "<r><a></b></r>",
+        "<r><a b='1'c='2'/></r>",
+        "<r>",
+        "",
+    ],
+)
+def test_load_fast_scan(contents: str) -> None:
+    expected = pugi.XMLDocument()
+    expected_result = expected.load_string(contents, pugi.PARSE_MINIMAL)
+    data = contents.encode()
+    options = pugi.PARSE_MINIMAL | pugi.PARSE_FAST_SCAN
+
+    doc = pugi.XMLDocument()
+    result = doc.load_string(contents, options)
+    assert result.status == expected_result.status
+    assert result.offset == expected_result.offset
+    assert _save_raw(doc) == _save_raw(expected)
+
+    expected_result = expected.load_buffer(data, len(data), pugi.PARSE_MINIMAL)
+    result = doc.load_buffer(data, len(data), options)
+    assert result.status == expected_result.status
+    assert result.offset == expected_result.offset
+    assert result.encoding == expected_result.encoding
+    assert _save_raw(doc) == _save_raw(expected)
+
+    with tempfile.TemporaryDirectory(prefix="pugixml-") as temp:
+        path = Path(temp) / "fast_scan.xml"
+        path.write_bytes(data)
+        result = doc.load_file(path, options)
+        assert result.status == expected_result.status
+        assert _save_raw(doc) == _save_raw(expected)
+
+
+def test_load_fast_scan_options() -> None:
+    contents = "<r a='&amp;'>&lt;\r\n</r>"
+    expected = pugi.XMLDocument()
+    assert expected.load_string(contents)
+    doc = pugi.XMLDocument()
+    assert doc.load_string(contents, pugi.PARSE_DEFAULT | pugi.PARSE_FAST_SCAN)
+    assert _save_raw(doc) == _save_raw(expected)
+    assert doc.child("r").attribute("a").value() == "&"
+    assert not doc.load_file("unknown.xml", pugi.PARSE_FAST_SCAN)
+
+
 def test_load_file() -> None:
     doc = pugi.XMLDocument()
 
@@ -139,6 +442,162 @@ def test_load_file() -> None:
     assert writer.getvalue() == "<node/>"
 
 
+def test_load_file_async() -> None:
+    async def load(
+        doc: pugi.XMLDocument, path: Path
+    ) -> pugi.XMLParseResult:
+        return await doc.load_file_async(path)
+
+    doc = pugi.XMLDocument()
+    result = asyncio.run(load(doc, testdata / "small.xml"))
+    assert isinstance(result, pugi.XMLParseResult)
+    assert result.status == pugi.STATUS_OK
+    assert result.encoding == pugi.ENCODING_UTF8
+
+    writer = pugi.StringWriter()
+    doc.print(writer, indent="", flags=pugi.FORMAT_RAW)
+    assert writer.getvalue() == "<node/>"
+
+    result = asyncio.run(load(doc, testdata / "not-found.xml"))
+    assert result.status == pugi.STATUS_FILE_NOT_FOUND
+
+    with pytest.raises(RuntimeError):
+        doc.load_file_async(testdata / "small.xml")  # no running event loop
+
+    async def load_cached(
+        doc: pugi.XMLDocument, path: Path, cache_dir: Path
+    ) -> pugi.XMLParseResult:
+        return await doc.load_file_async(path, cache_dir=cache_dir)
+
+    with tempfile.TemporaryDirectory(prefix="pugixml-") as temp:
+        path = Path(temp, "small.xml")
+        path.write_bytes(b"<node><child/></node>")
+        cache_dir = Path(temp, "cache")
+        for _ in range(2):  # cache miss, then cache hit
+            doc = pugi.XMLDocument()
+            assert asyncio.run(load_cached(doc, path, cache_dir))
+            assert _save_raw(doc) == "<node><child/></node>"
+            assert len(list(cache_dir.iterdir())) == 1
+
+
+def test_load_file_cache() -> None:
+    doc = pugi.XMLDocument()
+
+    with tempfile.TemporaryDirectory(prefix="pugixml-") as temp:
+        path = Path(temp, f"test_load_file_cache-{os.getpid()}.xml")
+        cache_dir = Path(temp, "cache")
+        path.write_bytes(b"<node><child a='1'/></node>")
+
+        result = doc.load_file(path, cache_dir=cache_dir)
+        assert result.status == pugi.STATUS_OK
+        assert result.encoding == pugi.ENCODING_UTF8
+        assert doc.child("node").child("child").attribute("a").as_int() == 1
+        assert len(list(cache_dir.iterdir())) == 1
+
+        # same size and mtime: loaded from the cache
+        stat = path.stat()
+        path.write_bytes(b"<node><child a='2'/></node>")
+        os.utime(path, ns=(stat.st_atime_ns, stat.st_mtime_ns))
+        result = doc.load_file(path, cache_dir=cache_dir)
+        assert result.status == pugi.STATUS_OK
+        assert result.encoding == pugi.ENCODING_UTF8
+        assert doc.child("node").child("child").attribute("a").as_int() == 1
+
+        # different options: parsed
+        result = doc.load_file(
+            str(path), pugi.PARSE_MINIMAL, cache_dir=str(cache_dir)
+        )
+        assert result.status == pugi.STATUS_OK
+        assert doc.child("node").child("child").attribute("a").as_int() == 2
+
+        # embedded values are kept in the cache
+        embed = Path(temp, f"test_load_file_cache-{os.getpid()}-embed.xml")
+        embed.write_bytes(b"<node>text<child/></node>")
+        for _ in range(2):
+            result = doc.load_file(
+                embed, pugi.PARSE_EMBED_PCDATA, cache_dir=cache_dir
+            )
+            assert result.status == pugi.STATUS_OK
+            assert doc.child("node").value() == "text"
+            assert doc.child("node").first_child().name() == "child"
+            assert len(list(doc.child("node").children())) == 1
+
+        # different mtime: parsed
+        path.write_bytes(b"<node><child a='3'/></node>")
+        os.utime(path, ns=(stat.st_atime_ns, stat.st_mtime_ns + 10**9))
+        result = doc.load_file(path, cache_dir=cache_dir)
+        assert result.status == pugi.STATUS_OK
+        assert doc.child("node").child("child").attribute("a").as_int() == 3
+
+        # broken cache: parsed
+        for cache in cache_dir.iterdir():
+            cache.write_bytes(cache.read_bytes()[:-8])
+        result = doc.load_file(path, cache_dir=cache_dir)
+        assert result.status == pugi.STATUS_OK
+        assert doc.child("node").child("child").attribute("a").as_int() == 3
+
+        path.write_bytes(b"<node>")
+        result = doc.load_file(path, cache_dir=cache_dir)
+        assert result.status == pugi.STATUS_END_ELEMENT_MISMATCH
+
+        result = doc.load_file(
+            Path(temp, "filedoesnotexist"), cache_dir=cache_dir
+        )
+        assert result.status == pugi.STATUS_FILE_NOT_FOUND
+
+
+@pytest.mark.parametrize("compression", ["gzip", "zstd"])
+def test_load_file_compressed(compression: str) -> None:
+    contents = b"<root>" + b"<item>text</item>" * 10000 + b"</root>"
+    doc = pugi.XMLDocument()
+    with tempfile.TemporaryDirectory(prefix="pugixml-") as temp:
+        path = Path(temp, f"test_load_file_compressed-{os.getpid()}.xml")
+        if not pugi.BUILD_OPTIONS[_CODECS[compression]]:
+            path.write_bytes(contents)
+            with pytest.raises(ValueError, match="not supported"):
+                doc.load_file(path, compression=compression)
+            return
+
+        data = _compress(compression, contents)
+        path.write_bytes(data)
+        assert doc.load_file(path)  # detected from the contents
+        assert len(doc.select_nodes("/root/item")) == 10000
+        assert doc.load_file(path, compression=compression)
+        assert len(doc.select_nodes("/root/item")) == 10000
+        assert not doc.load_file(path, compression="none")
+
+        cache_dir = Path(temp, "cache")
+        for _ in range(2):  # cache miss, then cache hit
+            assert doc.load_file(path, cache_dir=cache_dir)
+            assert len(doc.select_nodes("/root/item")) == 10000
+            assert len(list(cache_dir.iterdir())) == 1
+
+        path.write_bytes(
+            _compress(compression, contents[:100])
+            + _compress(compression, contents[100:])
+        )  # multiple members/frames
+        assert doc.load_file(path)
+        assert len(doc.select_nodes("/root/item")) == 10000
+
+        path.write_bytes(data[:-8])  # truncated
+        result = doc.load_file(path)
+        assert result.status == pugi.STATUS_IO_ERROR
+        assert doc.document_element().empty()
+
+        if compression == "gzip":
+            # the size in the trailer is only a hint
+            path.write_bytes(data[:-4] + b"\xff\xff\xff\xff")
+            pugi.memory.reset_stats()
+            live_bytes = pugi.memory.stats()["live_bytes"]
+            result = doc.load_file(path)
+            assert result.status == pugi.STATUS_IO_ERROR
+            peak_bytes = pugi.memory.stats()["peak_bytes"]
+            assert peak_bytes - live_bytes < 64 * 1024 * 1024
+
+        with pytest.raises(ValueError, match="unsupported compression"):
+            doc.load_file(path, compression="bz2")
+
+
 def test_load_file_fail() -> None:
     doc = pugi.XMLDocument()
 
@@ -149,6 +608,126 @@ def test_load_file_fail() -> None:
     assert result.status == pugi.STATUS_FILE_NOT_FOUND
 
 
+_RECORDS = "".join(
+    f'<record id="{i}"><name>n{i} &amp; &#233;</name><!--c--></record>\n'
+    for i in range(1000)
+)
+
+
+def test_load_file_fragments() -> None:
+    with tempfile.TemporaryDirectory(prefix="pugixml-") as temp:
+        path = Path(temp, f"test_load_file_fragments-{os.getpid()}.xml")
+        path.write_text(f'<root a="1">{_RECORDS}</root>', encoding="utf-8")
+        expected = pugi.XMLDocument()
+        assert expected.load_string(f"<root>{_RECORDS}</root>")
+        for threads in (1, 4, 64):
+            fragments = pugi.load_file_fragments(path, "record", threads)
+            assert 1 <= len(fragments) <= threads
+            records = [
+                record
+                for fragment in fragments
+                for record in fragment.children("record")
+            ]
+            assert len(records) == 1000
+            assert records[-1].attribute("id").as_int() == 999
+            doc = pugi.XMLDocument()
+            root = doc.append_child("root")
+            for fragment in fragments:
+                for child in fragment.children():
+                    root.append_copy(child)
+            assert _save_raw(doc) == _save_raw(expected)
+
+        # the records are parsed as one document if the runs do not parse
+        path.write_text(
+            f"<root><record><record/>{_RECORDS}</record></root>",
+            encoding="utf-8",
+        )
+        fragments = pugi.load_file_fragments(path, "record", 4)
+        assert len(fragments) == 1
+        assert len(fragments[0].children("record")) == 1
+        assert len(fragments[0].child("record").children("record")) == 1001
+
+        path.write_text("<root/>", encoding="utf-8")
+        assert pugi.load_file_fragments(path, "record", 4) == []
+
+        path.write_text("<root><record></root>", encoding="utf-8")
+        with pytest.raises(ValueError, match="mismatch"):
+            pugi.load_file_fragments(path, "record", 4)
+        with pytest.raises(ValueError):
+            pugi.load_file_fragments(Path(temp, "filedoesnotexist"), "a")
+        with pytest.raises(ValueError):
+            pugi.load_file_fragments(path, "")
+
+
+@pytest.mark.parametrize(
+    "contents",
+    [
+        f"<root>{_RECORDS}</root>",
+        f'<?xml version="1.0"?>\n<root a="1">\n{_RECORDS}</root>\n<!--c-->',
+        f"<root><head/><records>{_RECORDS}</records><tail/></root>",
+        f"<root><records>{_RECORDS}</records>\n</root>\n<?pi?>",
+        f"<root><!-- <record> --><records>{_RECORDS}</records></root>",
+        f"<root><record><record/>{_RECORDS}</record></root>",
+        f"<root><a>{_RECORDS}</a><b>{_RECORDS}</b></root>",
+        f"<root>{_RECORDS}<![CDATA[<record>]]>{_RECORDS}</root>",
+        f"<root>{_RECORDS}<!--<record>-->{_RECORDS}</root>",
+        f"<root><records/><recordx/>{_RECORDS}</root>",
+        "<root><record/></root>",
+        "<root/>",
+    ],
+)
+def test_load_file_parallel(contents: str) -> None:
+    expected = pugi.XMLDocument()
+    assert expected.load_string(contents)
+    doc = pugi.XMLDocument()
+    with tempfile.TemporaryDirectory(prefix="pugixml-") as temp:
+        path = Path(temp, f"test_load_file_parallel-{os.getpid()}.xml")
+        path.write_text(contents, encoding="utf-8")
+        for threads in (0, 1, 2, 3, 8, 64):
+            result = doc.load_file_parallel(path, "record", threads=threads)
+            assert result
+            assert result.encoding == pugi.ENCODING_UTF8
+            assert _save_raw(doc) == _save_raw(expected)
+
+        for options in (
+            pugi.PARSE_FULL,
+            pugi.PARSE_DEFAULT | pugi.PARSE_WS_PCDATA,
+            pugi.PARSE_DEFAULT | pugi.PARSE_WS_PCDATA_SINGLE,
+            pugi.PARSE_MINIMAL,
+        ):
+            assert expected.load_file(path, options)
+            assert doc.load_file_parallel(path, "record", 4, options)
+            assert _save_raw(doc) == _save_raw(expected)
+
+
+def test_load_file_parallel_fail() -> None:
+    doc = pugi.XMLDocument()
+    with tempfile.TemporaryDirectory(prefix="pugixml-") as temp:
+        path = Path(temp, f"test_load_file_parallel_fail-{os.getpid()}.xml")
+        path.write_bytes(b"<root>" + b"<record/>" * 1000 + b"</rot>")
+        result = doc.load_file_parallel(path, "record", 4)
+        assert result.status == pugi.STATUS_END_ELEMENT_MISMATCH
+
+        contents = "<root>" + "<record>\u00e9</record>" * 1000 + "</root>"
+        path.write_bytes(
+            b'<?xml version="1.0" encoding="ISO-8859-1"?>'
+            + contents.encode("latin-1")
+        )
+        assert doc.load_file_parallel(path, "record", 4)
+        assert doc.child("root").last_child().text().get() == "\u00e9"
+
+        path.write_bytes(contents.encode("utf-16"))
+        assert doc.load_file_parallel(path, "record", 4)
+        assert doc.child("root").last_child().text().get() == "\u00e9"
+
+        result = doc.load_file_parallel(Path(temp, "filedoesnotexist"), "a")
+        assert result.status == pugi.STATUS_FILE_NOT_FOUND
+        assert doc.document_element().empty()
+
+        with pytest.raises(TypeError):
+            doc.load_file_parallel(path, None)
+
+
 def test_load_string() -> None:
     doc = pugi.XMLDocument()
 
@@ -202,6 +781,59 @@ def test_load_string_fail() -> None:
         doc.load_string(None)
 
 
+@pytest.mark.usefixtures("block_tracking")
+def test_memory_usage() -> None:
+    doc = pugi.XMLDocument()
+    usage = doc.memory_usage()
+    assert usage["nodes"] == 0
+    assert usage["attributes"] == 0
+    assert usage["string_bytes"] == 0
+
+    doc.load_string('<node attr="value">text<child/></node>')
+    usage = doc.memory_usage()
+    assert usage["nodes"] == 3
+    assert usage["attributes"] == 1
+    assert usage["string_bytes"] == len("node\0attr\0value\0text\0child\0")
+    assert usage["struct_bytes"] > 0
+    assert usage["blocks"] > 0
+    assert (
+        usage["page_bytes"] >= usage["struct_bytes"] + usage["string_bytes"]
+    )
+    assert set(usage) == {
+        "nodes",
+        "attributes",
+        "struct_bytes",
+        "string_bytes",
+        "blocks",
+        "page_bytes",
+        "wasted_bytes",
+    }
+
+    root = doc.child("node")
+    for _ in range(1000):
+        root.append_child("item").append_attribute("id").set_value(1)
+    usage = doc.memory_usage()
+    assert usage["nodes"] == 1003
+    assert usage["attributes"] == 1001
+    assert usage["page_bytes"] >= usage["struct_bytes"]
+
+    for _ in range(1000):
+        root.remove_child("item")
+    usage = doc.memory_usage()
+    assert usage["nodes"] == 3
+    assert usage["wasted_bytes"] > 0
+
+
+def test_memory_usage_untracked() -> None:
+    doc = pugi.XMLDocument()
+    doc.load_string('<node attr="value">text<child/></node>')
+    usage = doc.memory_usage()
+    assert usage["nodes"] == 3
+    assert usage["struct_bytes"] > 0
+    assert usage["blocks"] == 0
+    assert usage["page_bytes"] == 0
+
+
 # https://github.com/zeux/pugixml/blob/master/tests/test_parse.cpp
 # TEST(parse_merge_pcdata)
 def test_parse_merge_pcdata() -> None:
@@ -245,6 +877,26 @@ def test_parse_result() -> None:
     assert repr(result).endswith(" description='Internal error occurred'>")
 
 
+def test_pickle() -> None:
+    doc = pugi.XMLDocument()
+    doc.load_string(
+        "<?xml version='1.0'?><!DOCTYPE node><node a='1' b=''>"
+        "<!--comment--><?pi value?><child>text</child><![CDATA[data]]>"
+        "</node>",
+        pugi.PARSE_FULL,
+    )
+    writer = pugi.StringWriter()
+    doc.save(writer, flags=pugi.FORMAT_RAW)
+    expected = writer.getvalue()
+
+    for protocol in range(pickle.HIGHEST_PROTOCOL + 1):
+        doc2 = pickle.loads(pickle.dumps(doc, protocol))
+        assert isinstance(doc2, pugi.XMLDocument)
+        writer = pugi.StringWriter()
+        doc2.save(writer, flags=pugi.FORMAT_RAW)
+        assert writer.getvalue() == expected
+
+
 def test_repr() -> None:
     doc = pugi.XMLDocument()
 
@@ -273,6 +925,55 @@ def test_reset() -> None:
     assert writer.getvalue() == "<node><child/></node>"
 
 
+def test_reset_keep_memory() -> None:
+    contents = "<node>" + '<child attr="value"/>' * 10000 + "</node>"
+    doc = pugi.XMLDocument()
+    pugi.memory.trim()
+
+    doc.load_string(contents)
+    live_blocks = pugi.memory.stats()["live_blocks"]
+    doc.reset(keep_memory=True)
+    stats = pugi.memory.stats()
+    assert stats["retained_blocks"] > 0
+    assert stats["retained_bytes"] > 0
+    assert stats["live_blocks"] < live_blocks
+    assert doc.first_child().empty()
+
+    pugi.memory.reset_stats()
+    assert doc.load_string(contents)
+    stats = pugi.memory.stats()
+    assert stats["reused_blocks"] > 0
+    assert len(doc.child("node").children()) == 10000
+
+    doc.reset(keep_memory=True)
+    pugi.memory.trim()
+    stats = pugi.memory.stats()
+    assert stats["retained_blocks"] == 0
+    assert stats["retained_bytes"] == 0
+
+
+def test_reset_keep_memory_pool() -> None:
+    allocator = pugi.memory.get_allocator()
+    pugi.memory.set_allocator("pool")
+    try:
+        doc = pugi.XMLDocument()
+        pugi.memory.trim()
+        reserved_bytes = pugi.memory.stats()["reserved_bytes"]
+
+        # the large buffer block is reused for the smaller document
+        doc.load_string("<node>" + "x" * 400_000 + "</node>")
+        doc.reset(keep_memory=True)
+        pugi.memory.reset_stats()
+        doc.load_string("<node>" + "x" * 300_000 + "</node>")
+        assert pugi.memory.stats()["reused_blocks"] > 0
+
+        doc.reset()
+        pugi.memory.trim()
+        assert pugi.memory.stats()["reserved_bytes"] == reserved_bytes
+    finally:
+        pugi.memory.set_allocator(allocator)
+
+
 # https://github.com/zeux/pugixml/blob/master/tests/test_document.cpp
 # document_save_bom()
 def test_save() -> None:
@@ -325,6 +1026,60 @@ def test_save_file() -> None:
             assert contents == b'<?xml version="1.0"?><node><child/></node>'
 
 
+def test_save_file_async() -> None:
+    async def save(docs: list[pugi.XMLDocument], temp: str) -> list[bool]:
+        return await asyncio.gather(
+            *(
+                doc.save_file_async(
+                    Path(temp, f"{i}.xml"), indent="", flags=pugi.FORMAT_RAW
+                )
+                for i, doc in enumerate(docs)
+            )
+        )
+
+    docs = []
+    for i in range(4):
+        doc = pugi.XMLDocument()
+        doc.append_child("node").append_attribute("id").set_value(i)
+        docs.append(doc)
+    with tempfile.TemporaryDirectory(prefix="pugixml-") as temp:
+        assert asyncio.run(save(docs, temp)) == [True] * 4
+        for i in range(4):
+            contents = Path(temp, f"{i}.xml").read_text()
+            assert contents == f'<?xml version="1.0"?><node id="{i}"/>'
+
+
+@pytest.mark.parametrize(
+    ("compression", "suffix"), [("gzip", ".gz"), ("zstd", ".zst")]
+)
+def test_save_file_compressed(compression: str, suffix: str) -> None:
+    doc = pugi.XMLDocument()
+    doc.load_string("<node><child/></node>")
+    expected = b'<?xml version="1.0"?>\n<node>\n\t<child />\n</node>\n'
+    with tempfile.TemporaryDirectory(prefix="pugixml-") as temp:
+        path = Path(temp, f"test_save_file_compressed.xml{suffix}")
+        if not pugi.BUILD_OPTIONS[_CODECS[compression]]:
+            with pytest.raises(ValueError, match="not supported"):
+                doc.save_file(path)
+            return
+
+        assert doc.save_file(path)  # selected from the suffix
+        assert _decompress(compression, path.read_bytes()) == expected
+        other = pugi.XMLDocument()
+        assert other.load_file(path)
+        assert _save_raw(other) == "<node><child/></node>"
+
+        plain = Path(temp, "test_save_file_compressed.xml")
+        assert doc.save_file(plain, compression=compression)
+        assert _decompress(compression, plain.read_bytes()) == expected
+
+        assert doc.save_file(path, compression="none")
+        assert path.read_bytes() == expected
+
+        with pytest.raises(ValueError, match="unsupported compression"):
+            doc.save_file(path, compression="bz2")
+
+
 def test_save_file_fail() -> None:
     doc = pugi.XMLDocument()
 
@@ -336,3 +1091,85 @@ def test_save_file_fail() -> None:
         path = Path(temp, f"test_save_file_fail-{os.getpid()}.xml")
         with pytest.raises(TypeError):
             doc.save_file(path, indent=None)  # indent is None
+
+
+def test_snapshot() -> None:
+    doc = pugi.XMLDocument()
+    doc.load_string(
+        "<node a='1' b='\u00e9'><child a='1'>text</child><child/></node>"
+    )
+
+    data = doc.save_snapshot()
+    assert isinstance(data, bytes)
+
+    doc2 = pugi.XMLDocument()
+    doc2.load_string("<old/>")
+    doc2.load_snapshot(data)
+    writer = pugi.StringWriter()
+    doc2.print(writer, flags=pugi.FORMAT_RAW)
+    assert (
+        writer.getvalue()
+        == '<node a="1" b="\u00e9"><child a="1">text</child><child/></node>'
+    )
+
+    doc2.load_snapshot(pugi.XMLDocument().save_snapshot())
+    assert doc2.first_child().empty()
+
+    doc.load_string(
+        "<node>a &amp; &lt;b&gt;\r\n<c> </c>tail</node>",
+        pugi.PARSE_DEFAULT | pugi.PARSE_WS_PCDATA | pugi.PARSE_EMBED_PCDATA,
+    )
+    doc2.load_snapshot(doc.save_snapshot())
+    node = doc2.child("node")
+    assert node.value() == doc.child("node").value()
+    assert node.text().get() == doc.child("node").text().get()
+    assert node.child("c").value() == " "
+    assert node.child("c").first_child().empty()
+    assert node.last_child().type() == pugi.NODE_PCDATA
+    assert node.last_child().value() == "tail"
+    assert len(list(node.children())) == 2
+
+    for invalid in (b"", b"PUGISNAP", data[:-8], b"\0" + data):
+        doc2.load_string("<old/>")
+        with pytest.raises(ValueError, match="invalid snapshot"):
+            doc2.load_snapshot(invalid)
+        assert doc2.first_child().empty()
+
+    with pytest.raises(TypeError):
+        doc2.load_snapshot(None)
+
+
+def test_snapshot_buffer() -> None:
+    doc = pugi.XMLDocument()
+    doc.load_string("<node><child a='1'>text</child></node>")
+    data = doc.save_snapshot()
+
+    doc2 = pugi.XMLDocument()
+    for buffer in (bytearray(data), memoryview(data), data + b"\0" * 16):
+        doc2.load_snapshot(buffer)
+        writer = pugi.StringWriter()
+        doc2.print(writer, flags=pugi.FORMAT_RAW)
+        assert writer.getvalue() == '<node><child a="1">text</child></node>'
+
+    shm = shared_memory.SharedMemory(create=True, size=len(data))
+    try:
+        shm.buf[: len(data)] = data
+        doc2.reset()
+        doc2.load_snapshot(shm.buf)
+        assert doc2.child("node").child("child").text().get() == "text"
+    finally:
+        shm.close()
+        shm.unlink()
+
+    with tempfile.TemporaryDirectory(prefix="pugixml-") as temp:
+        path = Path(temp, f"test_snapshot_buffer-{os.getpid()}.bin")
+        path.write_bytes(data)
+        with open(path, "rb") as f, mmap.mmap(
+            f.fileno(), 0, access=mmap.ACCESS_READ
+        ) as mm:
+            doc2.reset()
+            doc2.load_snapshot(mm)
+        assert doc2.child("node").child("child").attribute("a").as_int() == 1
+
+    with pytest.raises(BufferError):
+        doc2.load_snapshot(memoryview(data)[::2])
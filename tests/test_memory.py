@@ -0,0 +1,135 @@
+from __future__ import annotations
+
+import tracemalloc
+
+import pytest
+
+from pugixml import pugi
+
+
+@pytest.fixture
+def allocator():
+    name = pugi.memory.get_allocator()
+    yield
+    pugi.memory.set_allocator(name)
+
+
+def _build(count: int) -> pugi.XMLDocument:
+    doc = pugi.XMLDocument()
+    root = doc.append_child("root")
+    for n in range(count):
+        root.append_child("item").append_attribute("id").set_value(n)
+    root.append_child("text").text().set("x" * 100_000)
+    return doc
+
+
+@pytest.mark.usefixtures("allocator")
+@pytest.mark.parametrize("name", ["arena", "pool", "system"])
+def test_allocator(name: str) -> None:
+    pugi.memory.set_allocator(name)
+    assert pugi.memory.get_allocator() == name
+
+    stats = pugi.memory.stats()
+    assert stats["allocator"] == name
+    live_blocks = stats["live_blocks"]
+    live_bytes = stats["live_bytes"]
+
+    doc = _build(10_000)
+    doc2 = pugi.XMLDocument()
+    doc2.load_string("<node>" + "<child/>" * 10_000 + "</node>")
+    stats = pugi.memory.stats()
+    assert stats["live_blocks"] > live_blocks
+    assert stats["live_bytes"] > live_bytes
+    assert stats["reserved_bytes"] >= stats["live_bytes"]
+    assert len(doc.child("root").children("item")) == 10_000
+    assert len(doc2.child("node").children()) == 10_000
+
+    doc.reset()
+    doc2.reset()
+    pugi.memory.trim()
+    stats = pugi.memory.stats()
+    assert stats["live_blocks"] == live_blocks
+    assert stats["live_bytes"] == live_bytes
+
+
+@pytest.mark.usefixtures("allocator")
+def test_allocator_switch() -> None:
+    pugi.memory.set_allocator("arena")
+    doc1 = _build(1000)
+    pugi.memory.set_allocator("pool")
+    doc2 = _build(1000)
+    pugi.memory.set_allocator("system")
+    doc3 = _build(1000)
+
+    doc1.child("root").append_child("more")
+    writer = pugi.StringWriter()
+    doc2.print(writer)
+    del doc1, doc2, doc3
+
+
+@pytest.mark.usefixtures("allocator")
+def test_set_allocator_fail() -> None:
+    with pytest.raises(ValueError):
+        pugi.memory.set_allocator("unknown")
+    with pytest.raises(TypeError):
+        pugi.memory.set_allocator(None)
+
+
+def test_stats() -> None:
+    pugi.memory.reset_stats()
+    stats = pugi.memory.stats()
+    assert stats["allocations"] == 0
+    assert stats["deallocations"] == 0
+    assert stats["bytes_allocated"] == 0
+    assert stats["peak_bytes"] == stats["live_bytes"]
+
+    doc = _build(1000)
+    size = pugi.memory.stats()["live_bytes"] - stats["live_bytes"]
+    del doc
+    stats = pugi.memory.stats()
+    assert stats["allocations"] > 0
+    assert stats["allocations"] == stats["deallocations"]
+    assert stats["bytes_allocated"] >= size
+    assert stats["peak_bytes"] >= stats["live_bytes"] + size
+    assert set(stats) == {
+        "allocator",
+        "allocations",
+        "deallocations",
+        "bytes_allocated",
+        "live_blocks",
+        "live_bytes",
+        "peak_bytes",
+        "reserved_bytes",
+        "reused_blocks",
+        "retained_blocks",
+        "retained_bytes",
+    }
+
+
+def test_tracemalloc() -> None:
+    domain_filter = tracemalloc.DomainFilter(
+        True, pugi.memory.TRACEMALLOC_DOMAIN
+    )
+    tracemalloc.start()
+    try:
+        pugi.memory.set_tracemalloc(True)
+        doc = _build(1000)
+        snapshot = tracemalloc.take_snapshot().filter_traces([domain_filter])
+        size = sum(stat.size for stat in snapshot.statistics("filename"))
+        assert size >= doc.memory_usage()["struct_bytes"]
+
+        del doc
+        snapshot = tracemalloc.take_snapshot().filter_traces([domain_filter])
+        size = sum(stat.size for stat in snapshot.statistics("filename"))
+        assert size == 0
+
+        # the tracked blocks are untracked when the tracking is disabled
+        doc = _build(1000)
+        pugi.memory.set_tracemalloc(False)
+        snapshot = tracemalloc.take_snapshot().filter_traces([domain_filter])
+        size = sum(stat.size for stat in snapshot.statistics("filename"))
+        assert size == 0
+        del doc
+    finally:
+        pugi.memory.set_tracemalloc(False)
+        tracemalloc.stop()
@@ -1,5 +1,6 @@
 from __future__ import annotations
 
+import array
 import os
 import tempfile
 from contextlib import closing
@@ -237,6 +238,110 @@ def test_append_copy_node() -> None:
     )
 
 
+def test_append_element() -> None:
+    doc = pugi.XMLDocument()
+    node = doc.append_child("node")
+
+    n1 = node.append_element("item")
+    assert isinstance(n1, pugi.XMLNode)
+    assert n1.name() == "item"
+
+    n2 = node.append_element(
+        "item",
+        {"s": "foo", "b": True, "i": -1, "u": 2**64 - 1, "f": 0.5},
+        text=1.25,
+    )
+    assert n2 == node.last_child()
+    assert [attr.name() for attr in n2.attributes()] == [
+        "s",
+        "b",
+        "i",
+        "u",
+        "f",
+    ]
+    assert n2.attribute("u").as_ullong() == 2**64 - 1
+    assert n2.text().as_double() == 1.25
+
+    n3 = node.append_element("item", {"f": 1 / 3}, precision=3, text="bar")
+    assert n3.attribute("f").value() == "0.333"
+    assert n3.text().get() == "bar"
+
+    class Attributes:
+        def items(self):
+            return [("a", 1), ("b", 2)]
+
+    n4 = node.append_element("item", Attributes(), text=False)
+    assert n4.attribute("b").as_int() == 2
+
+    writer = pugi.StringWriter()
+    doc.print(writer, flags=pugi.FORMAT_RAW)
+    assert writer.getvalue() == (
+        "<node>"
+        "<item/>"
+        '<item s="foo" b="true" i="-1" u="18446744073709551615" f="0.5">'
+        "1.25</item>"
+        '<item f="0.333">bar</item>'
+        '<item a="1" b="2">false</item>'
+        "</node>"
+    )
+
+    assert pugi.XMLNode().append_element("item", {"a": 1}).empty()
+
+    with pytest.raises(TypeError):
+        node.append_element("item", {"a": None})
+
+    with pytest.raises(TypeError):
+        node.append_element("item", {1: "a"})
+
+    with pytest.raises(TypeError):
+        node.append_element("item", text=[])
+
+    with pytest.raises(OverflowError):
+        node.append_element("item", {"a": 2**64})
+
+    assert len(list(node.children())) == 4
+
+
+def test_append_elements() -> None:
+    doc = pugi.XMLDocument()
+    node = doc.append_child("node")
+
+    count = node.append_elements(
+        "row", ({"id": n, "value": n / 4} for n in range(3))
+    )
+    assert count == 3
+    assert count == len(list(node.children("row")))
+    assert node.append_elements("row", []) == 0
+    assert node.append_elements("row", [{}]) == 1
+    assert pugi.XMLNode().append_elements("row", [{"id": 1}]) == 0
+
+    writer = pugi.StringWriter()
+    doc.print(writer, flags=pugi.FORMAT_RAW)
+    assert writer.getvalue() == (
+        "<node>"
+        '<row id="0" value="0"/>'
+        '<row id="1" value="0.25"/>'
+        '<row id="2" value="0.5"/>'
+        "<row/>"
+        "</node>"
+    )
+
+    with pytest.raises(TypeError):
+        node.append_elements("row", [{"id": object()}])
+
+    with pytest.raises(TypeError):
+        node.append_elements("row", [{"id": 1}, {"id": 2}, {1: "a"}])
+
+    def rows():
+        yield {"id": 1}
+        raise ValueError
+
+    with pytest.raises(ValueError):
+        node.append_elements("row", rows())
+
+    assert len(list(node.children())) == 4
+
+
 def test_append_move() -> None:
     doc = pugi.XMLDocument()
     doc.load_string("<node>foo<child/></node>")
@@ -562,6 +667,52 @@ def test_ensure_child() -> None:
     assert writer.getvalue() == "<node>foo<child/><n1/></node><n2/>"
 
 
+def test_extract_columns() -> None:
+    doc = pugi.XMLDocument()
+    doc.load_string(
+        '<rows><row a="1" b="0.5"><c>x</c></row><skip a="9"/>'
+        '<row a="-2" b="abc"><c>y</c><d/><d/></row><row/></rows>'
+    )
+    node = doc.child("rows")
+
+    columns = node.extract_columns(
+        "row",
+        {"a": "@a", "b": "@b", "c": "c/text()", "d": "count(d)"},
+        {"a": "int", "b": "double", "d": "llong"},
+    )
+    assert list(columns) == ["a", "b", "c", "d"]
+    assert isinstance(columns["a"], array.array)
+    assert columns["a"].typecode == "i"
+    assert columns["a"].tolist() == [1, -2, 0]
+    assert columns["b"].typecode == "d"
+    assert columns["b"].tolist() == [0.5, 0.0, 0.0]
+    assert columns["c"] == ["x", "y", ""]
+    assert columns["d"].typecode == "q"
+    assert columns["d"].tolist() == [0, 2, 0]
+
+    columns = node.extract_columns(
+        "row",
+        {"a": "@a", "c": "c", "n": "string(c)"},
+        {"a": "bool"},
+    )
+    assert columns["a"].typecode == "B"
+    assert columns["a"].tolist() == [1, 0, 0]
+    assert columns["c"] == ["x", "y", ""]
+    assert columns["n"] == ["x", "y", ""]
+
+    assert node.extract_columns("none", {"a": "@a"}) == {"a": []}
+    assert pugi.XMLNode().extract_columns("row", {"a": "@a"}) == {"a": []}
+
+    with pytest.raises(ValueError, match="unsupported column type"):
+        node.extract_columns("row", {"a": "@a"}, {"a": "int8"})
+
+    with pytest.raises(ValueError):
+        node.extract_columns("row", {"a": "@@a"})
+
+    with pytest.raises(TypeError):
+        node.extract_columns(None, {"a": "@a"})
+
+
 def test_file_writer() -> None:
     doc = pugi.XMLDocument()
     doc.load_string("<node><child>\U0001f308</child></node>")
@@ -1305,6 +1456,55 @@ def test_name_value() -> None:
     assert children[1].value() == "cdata"
 
 
+def test_name_value_non_ascii() -> None:
+    doc = pugi.XMLDocument()
+    name = "\u5546\u54c1"
+    value = "caf\u00e9 \u6771\u4eac \U0001f600"
+    doc.load_string(f'<{name} {name}="{value}">{value}</{name}>')
+    node = doc.child(name)
+    assert node.name() == name
+    assert node.attribute(name).name() == name
+    assert node.attribute(name).value() == value
+    assert node.first_child().value() == value
+    assert node.child_value() == value
+    assert node.text().get() == value
+    assert doc.child_value(name) == value
+
+
+def test_name_interned() -> None:
+    doc = pugi.XMLDocument()
+    doc.load_string('<node><item id="1"/><item id="2"/></node>')
+    doc2 = pugi.XMLDocument()
+    doc2.load_string('<item id="3"/>')
+
+    item1 = doc.child("node").first_child()
+    item2 = item1.next_sibling()
+    item3 = doc2.first_child()
+    assert item1.name() == "item"
+    assert item1.name() is item2.name()
+    assert item1.name() is item3.name()
+    assert item1.first_attribute().name() is item3.first_attribute().name()
+    assert len(pugi.XMLNode().name()) == 0
+
+    name = "x" * 1000
+    node = doc.append_child(name)
+    assert node.name() == name
+
+    item3.set_name("renamed")
+    assert item3.name() == "renamed"
+    assert item1.name() == "item"
+
+    # the oldest names are evicted from the full cache
+    root = doc2.append_child("root")
+    for i in range(10000):
+        assert root.append_child(f"name{i}").name() == f"name{i}"
+    assert item1.name() == "item"
+    assert [child.name() for child in root.children()][:2] == [
+        "name0",
+        "name1",
+    ]
+
+
 def test_next_previous_sibling() -> None:
     doc = pugi.XMLDocument()
     doc.load_string("<node><child1/><child2/><child3/></node>")
@@ -1636,6 +1836,67 @@ def test_print() -> None:
         doc.print(writer, indent=None)
 
 
+@pytest.mark.parametrize(
+    "contents",
+    [
+        "<root a='1 &amp; 2'>"
+        + "".join(f"<r i='{i}'><v>{i} &lt; \u00e9</v></r>" for i in range(50))
+        + "</root>",
+        "<?xml version='1.0'?><!--c--><root><items>"
+        + "<item/>text<item>x</item><![CDATA[y]]><?pi?><!--z-->" * 20
+        + "</items></root><!--end-->",
+        "<root><a><b><c/><c>1</c></b></a></root>",
+        "<root>text<a/>text</root>",
+        "<root>text</root>",
+        "<root/>",
+    ],
+)
+@pytest.mark.parametrize(
+    "flags",
+    [
+        pugi.FORMAT_DEFAULT,
+        pugi.FORMAT_RAW,
+        pugi.FORMAT_INDENT_ATTRIBUTES,
+        pugi.FORMAT_INDENT | pugi.FORMAT_NO_EMPTY_ELEMENT_TAGS,
+        pugi.FORMAT_RAW | pugi.FORMAT_ATTRIBUTE_SINGLE_QUOTE,
+    ],
+)
+def test_print_parallel(contents: str, flags: int) -> None:
+    doc = pugi.XMLDocument()
+    assert doc.load_string(contents, pugi.PARSE_FULL | pugi.PARSE_WS_PCDATA)
+    for node in (doc, doc.document_element()):
+        for encoding in (pugi.ENCODING_AUTO, pugi.ENCODING_UTF16_BE):
+            for depth in (0, 2):
+                expected = _TestWriter()
+                node.print(expected, "  ", flags, encoding, depth)
+                for threads in (0, 1, 2, 3, 64):
+                    writer = _TestWriter()
+                    node.print_parallel(
+                        writer, "  ", flags, encoding, depth, threads
+                    )
+                    assert writer.getvalue() == expected.getvalue()
+                    native = pugi.BytesWriter()
+                    node.print_parallel(
+                        native, "  ", flags, encoding, depth, threads
+                    )
+                    assert native.getvalue() == expected.getvalue()
+
+    writer = _TestWriter()
+    pugi.XMLNode().print_parallel(writer)
+    assert writer.getvalue() == b""
+    with pytest.raises(TypeError):
+        doc.print_parallel(writer, indent=None)
+
+    class FailingWriter(pugi.XMLWriter):
+        def write(self, data: bytes, size: int) -> None:
+            raise ValueError
+
+    doc.load_string("<root>" + "<r>text</r>" * 10000 + "</root>")
+    for threads in (1, 4):
+        with pytest.raises(ValueError):
+            doc.print_parallel(FailingWriter(), threads=threads)
+
+
 def test_print_writer(capsys: pytest.CaptureFixture[str]) -> None:
     doc = pugi.XMLDocument()
     doc.load_string("<node><child>\U0001f308</child></node>")
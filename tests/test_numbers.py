@@ -0,0 +1,102 @@
+from __future__ import annotations
+
+import array
+import math
+
+import pytest
+
+from pugixml import pugi
+
+
+def _document() -> pugi.XMLDocument:
+    doc = pugi.XMLDocument()
+    doc.load_string(
+        "<rows>"
+        '<row n="1"><v>1.5</v></row>'
+        '<row n=" +0x1F "><v> -2e3 </v></row>'
+        '<row n="abc"><v>inf</v></row>'
+        '<row n=""><v>1.5x</v></row>'
+        '<row n="-4"><v/></row>'
+        "</rows>"
+    )
+    return doc
+
+
+def test_parse_numbers_errors() -> None:
+    values, errors = pugi.parse_numbers(["1", "99999999999", "-1"], "int")
+    assert values == array.array("i", [1, 0, -1])
+    assert errors == [1]
+
+    values, errors = pugi.parse_numbers(["1", "-1", "+-1"], "uint")
+    assert values == array.array("I", [1, 0, 0])
+    assert errors == [1, 2]
+
+    values, errors = pugi.parse_numbers(
+        ["-0x10", "0x-10", "+0x10", "0x+10", "-0x80000000", "-0x80000001"],
+        "int",
+    )
+    assert values == array.array("i", [-16, 0, 16, 0, -(2**31), 0])
+    assert errors == [1, 3, 5]
+
+    values, errors = pugi.parse_numbers(["0xFFFFFFFF", "-0x1"], "uint")
+    assert values == array.array("I", [2**32 - 1, 0])
+    assert errors == [1]
+
+    values, errors = pugi.parse_numbers([], "double")
+    assert len(values) == 0
+    assert errors == []
+
+
+def test_parse_numbers_fail() -> None:
+    with pytest.raises(ValueError, match="unsupported number type"):
+        pugi.parse_numbers([], "string")
+    with pytest.raises(ValueError, match="unsupported number type"):
+        pugi.parse_numbers([], "bool")
+    with pytest.raises(TypeError):
+        pugi.parse_numbers(["1", 2], "int")
+    with pytest.raises(TypeError):
+        pugi.parse_numbers(None, "int")
+
+
+def test_parse_numbers_node_set() -> None:
+    doc = _document()
+    values, errors = pugi.parse_numbers(doc.select_nodes("//row/@n"), "int")
+    assert values == array.array("i", [1, 31, 0, 0, -4])
+    assert errors == [2, 3]
+
+    values, errors = pugi.parse_numbers(doc.select_nodes("//row/v"))
+    assert values.typecode == "d"
+    assert values[:2] == array.array("d", [1.5, -2000.0])
+    assert math.isinf(values[2])
+    assert errors == [3, 4]
+
+
+@pytest.mark.parametrize(
+    ("type_", "typecode"),
+    [
+        ("int", "i"),
+        ("uint", "I"),
+        ("llong", "q"),
+        ("ullong", "Q"),
+        ("float", "f"),
+        ("double", "d"),
+    ],
+)
+def test_parse_numbers_types(type_: str, typecode: str) -> None:
+    doc = _document()
+    rows = doc.child("rows").children("row")
+    items = [
+        rows[0].attribute("n"),
+        rows[0].child("v"),
+        rows[0].child("v").text(),
+        rows[0].child("v").first_child(),
+        doc.select_node("//row/@n"),
+        "7",
+    ]
+    values, errors = pugi.parse_numbers(iter(items), type_)
+    assert values.typecode == typecode
+    assert errors == ([1, 2, 3] if typecode in "iIqQ" else [])
+    expected = [1, 1.5, 1.5, 1.5, 1, 7]
+    for n, value in enumerate(values):
+        if n not in errors:
+            assert value == expected[n]
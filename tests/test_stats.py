@@ -0,0 +1,129 @@
+from __future__ import annotations
+
+import pytest
+
+from pugixml import pugi
+
+
+@pytest.fixture
+def stats():
+    pugi.stats.reset()
+    pugi.stats.enable()
+    yield
+    pugi.stats.disable()
+    pugi.stats.reset()
+
+
+@pytest.mark.usefixtures("stats")
+def test_compile() -> None:
+    doc = pugi.XMLDocument()
+    doc.load_string("<node><child/><child/></node>")
+    query = pugi.XPathQuery("//child")
+    assert len(query.evaluate_node_set(doc)) == 2
+    assert query.evaluate_node(doc)
+    assert query.evaluate_boolean(doc)
+    doc.select_nodes("//child")
+    doc.select_node("//child")
+    doc.select_nodes(query)
+    snapshot = pugi.stats.snapshot()
+    item = snapshot["compile"]
+    assert item["calls"] == 3
+    assert item["bytes"] >= len("//child") * 3
+    assert item["time_ns"] > 0
+    item = snapshot["select"]
+    assert item["calls"] == 6
+    assert item["nodes"] == 8
+
+
+def test_disabled() -> None:
+    pugi.stats.reset()
+    assert not pugi.stats.is_enabled()
+    doc = pugi.XMLDocument()
+    doc.load_string("<node><child/></node>")
+    doc.select_nodes("//child")
+    for item in pugi.stats.snapshot().values():
+        assert item["calls"] == 0
+
+
+@pytest.mark.usefixtures("stats")
+def test_load() -> None:
+    assert pugi.stats.is_enabled()
+    contents = "<node>" + "<child/>" * 1000 + "</node>"
+    doc = pugi.XMLDocument()
+    doc.load_string(contents)
+    data = contents.encode()
+    doc.load_buffer(data, len(data))
+    item = pugi.stats.snapshot()["load"]
+    assert item["calls"] == 2
+    assert item["bytes"] >= len(data) * 2
+    assert item["time_ns"] > 0
+    assert item["allocations"] > 0
+    assert item["allocated_bytes"] > 0
+
+
+@pytest.mark.usefixtures("stats")
+def test_reset() -> None:
+    doc = pugi.XMLDocument()
+    doc.load_string("<node/>")
+    assert pugi.stats.snapshot()["load"]["calls"] == 1
+    pugi.stats.reset()
+    for item in pugi.stats.snapshot().values():
+        assert set(item.values()) == {0}
+
+
+@pytest.mark.usefixtures("stats")
+def test_save() -> None:
+    doc = pugi.XMLDocument()
+    doc.append_child("node").append_child("child")
+    writer = pugi.StringWriter()
+    doc.save(writer)
+    doc.first_child().print(writer)
+    item = pugi.stats.snapshot()["save"]
+    assert item["calls"] == 2
+    assert item["bytes"] == len(writer)
+
+
+@pytest.mark.usefixtures("stats")
+def test_select() -> None:
+    doc = pugi.XMLDocument()
+    doc.load_string("<node><child/><child/><child/></node>")
+    assert len(doc.select_nodes("//child")) == 3
+    assert doc.select_node(pugi.XPathQuery("//child"))
+    assert not doc.select_node("//none")
+    item = pugi.stats.snapshot()["select"]
+    assert item["calls"] == 3
+    assert item["nodes"] == 4
+
+
+def test_snapshot() -> None:
+    snapshot = pugi.stats.snapshot()
+    assert set(snapshot) == {
+        "load",
+        "save",
+        "select",
+        "traverse",
+        "compile",
+    }
+    for item in snapshot.values():
+        assert set(item) == {
+            "calls",
+            "bytes",
+            "nodes",
+            "time_ns",
+            "allocations",
+            "allocated_bytes",
+        }
+
+
+@pytest.mark.usefixtures("stats")
+def test_traverse() -> None:
+    class Walker(pugi.XMLTreeWalker):
+        def for_each(self, node: pugi.XMLNode) -> bool:
+            return True
+
+    doc = pugi.XMLDocument()
+    doc.load_string("<node><child1><child2/></child1><child3/></node>")
+    assert doc.traverse(Walker())
+    item = pugi.stats.snapshot()["traverse"]
+    assert item["calls"] == 1
+    assert item["nodes"] == 4
@@ -0,0 +1,203 @@
+from __future__ import annotations
+
+import pytest
+
+from pugixml import pugi
+
+CONTENTS = (
+    '<root a="1&amp;2" b="&quot;x&apos;">'
+    "<empty/>"
+    '<item id="x">text &lt; 1 &#233;</item>'
+    '<group><child/><child c=""/><leaf>0.5</leaf></group>'
+    "</root>"
+)
+
+
+def _write_events(stream: pugi.XMLStreamWriter, node: pugi.XMLNode) -> None:
+    if node.type() == pugi.NODE_PCDATA:
+        stream.text(node.value())
+        return
+    stream.start_element(node.name())
+    for attr in node.attributes():
+        stream.attribute(attr.name(), attr.value())
+    for child in node.children():
+        _write_events(stream, child)
+    stream.end_element()
+
+
+def _save(doc: pugi.XMLDocument, **kwargs) -> bytes:
+    writer = pugi.BytesWriter()
+    doc.save(writer, **kwargs)
+    return writer.getvalue()
+
+
+def test_close() -> None:
+    writer = pugi.BytesWriter()
+    stream = pugi.XMLStreamWriter(writer, flags=pugi.FORMAT_RAW)
+    stream.start_element("a")
+    stream.start_element("b")
+    assert stream.depth == 2
+    assert not stream.closed
+    stream.close()
+    assert stream.closed
+    assert stream.depth == 0
+    assert writer.getvalue() == b'<?xml version="1.0"?><a><b/></a>'
+
+    stream.close()  # no effect
+    assert writer.getvalue() == b'<?xml version="1.0"?><a><b/></a>'
+    for method, args in (
+        ("start_element", ("c",)),
+        ("attribute", ("c", "1")),
+        ("text", ("c",)),
+        ("end_element", ()),
+        ("write_node", (pugi.XMLNode(),)),
+    ):
+        with pytest.raises(ValueError, match="after close"):
+            getattr(stream, method)(*args)
+
+
+@pytest.mark.parametrize(
+    "encoding",
+    [
+        pugi.ENCODING_AUTO,
+        pugi.ENCODING_UTF8,
+        pugi.ENCODING_UTF16_LE,
+        pugi.ENCODING_UTF32_BE,
+        pugi.ENCODING_LATIN1,
+    ],
+)
+def test_encoding(encoding: pugi.XMLEncoding) -> None:
+    doc = pugi.XMLDocument()
+    assert doc.load_string(CONTENTS)
+
+    writer = pugi.BytesWriter()
+    stream = pugi.XMLStreamWriter(writer, encoding=encoding)
+    _write_events(stream, doc.document_element())
+    stream.close()
+    assert writer.getvalue() == _save(doc, encoding=encoding)
+
+
+def test_errors() -> None:
+    stream = pugi.XMLStreamWriter(pugi.BytesWriter())
+    with pytest.raises(ValueError, match="without start_element"):
+        stream.end_element()
+    with pytest.raises(ValueError, match="must follow start_element"):
+        stream.attribute("a", "1")
+
+    stream.start_element("a")
+    with pytest.raises(TypeError):
+        stream.attribute("b", None)
+    with pytest.raises(TypeError):
+        stream.text(object())
+    with pytest.raises(TypeError):
+        stream.start_element(None)
+
+    stream.text("text")
+    with pytest.raises(ValueError, match="must follow start_element"):
+        stream.attribute("b", "1")
+
+
+@pytest.mark.parametrize(
+    "flags",
+    [
+        pugi.FORMAT_DEFAULT,
+        pugi.FORMAT_RAW,
+        pugi.FORMAT_INDENT | pugi.FORMAT_NO_DECLARATION,
+        pugi.FORMAT_INDENT | pugi.FORMAT_WRITE_BOM,
+        pugi.FORMAT_INDENT_ATTRIBUTES,
+        pugi.FORMAT_INDENT | pugi.FORMAT_NO_EMPTY_ELEMENT_TAGS,
+        pugi.FORMAT_RAW | pugi.FORMAT_ATTRIBUTE_SINGLE_QUOTE,
+        pugi.FORMAT_RAW | pugi.FORMAT_NO_ESCAPES,
+    ],
+)
+def test_flags(flags: int) -> None:
+    doc = pugi.XMLDocument()
+    assert doc.load_string(CONTENTS)
+
+    writer = pugi.BytesWriter()
+    stream = pugi.XMLStreamWriter(writer, indent="  ", flags=flags)
+    _write_events(stream, doc.document_element())
+    stream.close()
+    assert writer.getvalue() == _save(doc, indent="  ", flags=flags)
+
+
+def test_flush() -> None:
+    writer = pugi.BytesWriter()
+    stream = pugi.XMLStreamWriter(writer, flags=pugi.FORMAT_RAW)
+    stream.start_element("a")
+    stream.attribute("b", 1)
+    assert len(writer) == 0
+
+    stream.flush()
+    assert writer.getvalue() == b'<?xml version="1.0"?><a b="1"'
+
+    stream.text(True)
+    stream.text(0.25)
+    stream.close()
+    assert writer.getvalue() == b'<?xml version="1.0"?><a b="1">true0.25</a>'
+
+    class ChunkWriter(pugi.XMLWriter):
+        def __init__(self) -> None:
+            super().__init__()
+            self.chunks: list[bytes] = []
+
+        def write(self, data: bytes, size: int) -> None:
+            assert len(data) == size
+            self.chunks.append(data)
+
+    writer = ChunkWriter()
+    stream = pugi.XMLStreamWriter(writer, flags=pugi.FORMAT_RAW)
+    stream.start_element("rows")
+    for i in range(10000):
+        stream.start_element("row")
+        stream.attribute("id", i)
+        stream.end_element()
+    assert len(writer.chunks) > 1  # written while the rows are added
+    stream.close()
+
+    doc = pugi.XMLDocument()
+    contents = b"".join(writer.chunks)
+    assert doc.load_buffer(contents, len(contents))
+    assert len(doc.select_nodes("/rows/row")) == 10000
+
+
+def test_mixed_content() -> None:
+    writer = pugi.StringWriter()
+    stream = pugi.XMLStreamWriter(writer, flags=pugi.FORMAT_NO_DECLARATION)
+    stream.start_element("p")
+    stream.text("a")
+    stream.start_element("b")
+    stream.text("b")
+    stream.end_element()
+    stream.text("c")
+    stream.close()
+
+    doc = pugi.XMLDocument()
+    assert doc.load_string(writer.getvalue())
+    assert doc.child("p").first_child().value() == "a"
+    assert doc.child("p").child("b").text().get() == "b"
+    assert doc.child("p").last_child().value() == "c"
+
+
+@pytest.mark.parametrize("flags", [pugi.FORMAT_DEFAULT, pugi.FORMAT_RAW])
+def test_write_node(flags: int) -> None:
+    expected = pugi.XMLDocument()
+    rows = expected.append_child("rows")
+    rows.append_attribute("count").set_value(3)
+
+    writer = pugi.BytesWriter()
+    stream = pugi.XMLStreamWriter(writer, flags=flags)
+    stream.start_element("rows")
+    stream.attribute("count", 3)
+    fragment = pugi.XMLDocument()
+    for i in range(3):
+        fragment.reset()
+        row = fragment.append_child("row")
+        row.append_attribute("id").set_value(i)
+        row.append_child("value").text().set(f"<{i}>")
+        stream.write_node(row)
+        rows.append_copy(row)
+    stream.write_node(pugi.XMLNode())  # ignored
+    stream.end_element()
+    stream.close()
+    assert writer.getvalue() == _save(expected, flags=flags)